@@ -64,6 +64,8 @@ std::vector<std::string> Extensions::kFinderInputFileFormats()
                                extensions.begin(), extensions.end());
 
     finder_file_formats.push_back("gz");
+    finder_file_formats.push_back("bgz");
+    finder_file_formats.push_back("zst");
     return finder_file_formats;
 }
 
@@ -71,6 +73,8 @@ std::vector<std::string> Extensions::kFinderReferenceFileFormats()
 {
     auto extensions = FastaFile::extensions();
     extensions.push_back("gz");
+    extensions.push_back("bgz");
+    extensions.push_back("zst");
 
     auto tempExtensions = GenBankFile::extensions();
     extensions.insert(extensions.end(),
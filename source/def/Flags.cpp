@@ -45,6 +45,15 @@ const char Flags::kFastqQuality[] = "fastq-quality-set";
 const char Flags::kOverrideExistingQuality[] = "defquality";
 const char Flags::kSearchBindingTargets[] = "binding-targets";
 const char Flags::kGenBankInputFormat[] = "genbank-input";
+const char Flags::kReadAheadBuffers[] = "read-ahead-buffers";
+const char Flags::kReadAheadBufferSize[] = "read-ahead-buffer-size";
+const char Flags::kDecompressionThreads[] = "decompression-threads";
+const char Flags::kCompressionThreads[] = "compression-threads";
+const char Flags::kAsyncOutput[] = "async-output";
+const char Flags::kGzipIndexSpan[] = "gzip-index-span";
+const char Flags::kIoBackend[] = "io-backend";
+const char Flags::kVerifyChecksums[] = "verify-checksums";
+const char Flags::kBuildIndex[] = "build-index";
 const char Flags::kIllumina1_8Suffix[] = "Illumina 1.8+";
 const char Flags::kIllumina1_5Suffix[] = "Illumina 1.5";
 const char Flags::kIllumina1_3Suffix[] = "Illumina 1.3";
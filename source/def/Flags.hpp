@@ -97,6 +97,42 @@ class Flags {
     // * no specific option * - selected if input has .gb or .gbk extension
     static const char kGenBankInputFormat[];
 
+    // *Textfield* – number of buffers compressed input is inflated into ahead
+    // of parsing (0 disables the read-ahead thread)
+    static const char kReadAheadBuffers[];
+
+    // *Textfield* – size of each read-ahead buffer, in KiB
+    static const char kReadAheadBufferSize[];
+
+    // *Textfield* – number of threads inflating BGZF-compressed input,
+    // including BAM (0 uses all hardware threads)
+    static const char kDecompressionThreads[];
+
+    // *Textfield* – number of threads compressing .gz/.bgz/.zst output,
+    // including BAM (0 uses all hardware threads)
+    static const char kCompressionThreads[];
+
+    // *Checkbox with corresponding field* – write output on a separate thread,
+    // with the given number of 1 MiB buffers (4 if not set)
+    static const char kAsyncOutput[];
+
+    // *Textfield* – build a random access index (<file>.gzidx) for plain
+    // gzip input, with a checkpoint every given number of MiB
+    static const char kGzipIndexSpan[];
+
+    // *Textfield* – how files are read and written: stdio (default), read,
+    // mmap, io_uring or direct
+    static const char kIoBackend[];
+
+    // *Checkbox* – check the CRC32 of every BGZF block (BAM, bgzipped input)
+    // against the one stored in its footer
+    static const char kVerifyChecksums[];
+
+    // *Checkbox* – build a .bai index (.csi for references over 512 Mbp)
+    // while reading a whole coordinate-sorted BAM or writing one, and save
+    // it at the end
+    static const char kBuildIndex[];
+
     // DEPRECATED - always on
     static const char kVerbose[];
 
@@ -33,7 +33,8 @@ SeparatedFile::SeparatedFile(const std::string& path,
                              char separator)
 : IOFile(path,
          (separator == ',' ? FileType::Csv : FileType::Tsv),
-         mode),
+         mode,
+         flags),
   separator_(separator)
 {
     header_done_ = false;
@@ -71,9 +72,7 @@ void SeparatedFile::Prepare_(OpenMode mode)
 
 void SeparatedFile::ReadHeader_()
 {
-    std::string header_line = in_file_->ReadLine();
-
-    tokenizer_->SetText(header_line);
+    tokenizer_->SetText(in_file_->ReadLineView());
     while (tokenizer_->ReadNext())
         header_.push_back(tokenizer_->GetNextToken());
 }
@@ -181,9 +180,23 @@ std::string SeparatedFile::ReadLine()
     return in_file_->ReadLine();
 }
 
+std::string_view SeparatedFile::ReadLineView()
+{
+    return in_file_->ReadLineView();
+}
+
+int64_t SeparatedFile::FindRecordStart_()
+{
+    // Rows are read line by line, so newlines inside quoted fields aren't
+    // supported and every line starts a row
+    if (in_file_->Peek() == EOF)
+        return -1;
+    return in_file_->uncompressed_position();
+}
+
 std::vector<std::string> SeparatedFile::ReadNextRow()
 {
-    std::string last_read_line = in_file_->ReadLine();
+    std::string_view last_read_line = in_file_->ReadLineView();
     std::vector<std::string> next_row;
 
     if (last_read_line.empty())
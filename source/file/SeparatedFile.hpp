@@ -19,6 +19,7 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <memory>
 
 #include "../flags/CommandLineFlags.hpp"
@@ -39,6 +40,10 @@ class SeparatedFile : public IOFile {
     std::unique_ptr<Tokenizer> tokenizer_;
     char separator_;
 
+    // Takes the next line as the next row: quoted fields with embedded
+    // newlines aren't supported, so a range may start inside one
+    int64_t FindRecordStart_() override;
+
  public:
     SeparatedFile(const std::string& path,
                   const std::unique_ptr<CommandLineFlags>& flags,
@@ -69,6 +74,8 @@ class SeparatedFile : public IOFile {
     void WriteQuoted(const std::string& str);
 
     std::string ReadLine();
+    // The view is only valid until the next read from the file
+    std::string_view ReadLineView();
     std::unique_ptr<ColumnTypesConfigurationCpp> column_types;
 };
 
@@ -31,7 +31,7 @@ AlignmentFile::AlignmentFile(std::string path,
                              FileType type,
                              const std::unique_ptr<CommandLineFlags>& flags,
                              OpenMode mode)
-: IOFile(path, type, mode)
+: IOFile(path, type, mode, flags)
 {
 }
 
@@ -61,11 +61,13 @@ auto AlignmentFile::FileWithName(const std::string& path,
 {
     try {
         auto extension = utils::GetExtension(path);
-        if (extension == "sam" || extension == "SAM") {
+        // Text formats are read through the streams, which decompress
+        auto text_extension = utils::GetExtensionCompressed(path);
+        if (text_extension == "sam" || text_extension == "SAM") {
             return std::make_unique<SamFile>(path, flags, mode);
         } else if (extension == "bam" || extension == "BAM") {
             return std::make_unique<BamFile>(path, flags, mode);
-        } else if (extension == "bed" || extension == "BED") {
+        } else if (text_extension == "bed" || text_extension == "BED") {
             return std::make_unique<BedFile>(path, flags, mode);
         }
         return nullptr;
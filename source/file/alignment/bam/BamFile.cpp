@@ -15,295 +15,629 @@
  */
 
 #include <iostream>
+#include <algorithm>
 #include <cassert>
+#include <array>
+#include <cstring>
 #include <vector>
 #include <string>
+#include <string_view>
 #include <memory>
+#include <thread>
 
 #include "BamFile.hpp"
+#include "BamSequence.hpp"
 #include "BamUtils.hpp"
 #include "../sam/SamFile.hpp"
 #include "../sam/SamRecord.hpp"
+#include "../../../def/Flags.hpp"
+#include "../../../io/streams/BgzfStringOutputStream.hpp"
+#include "../../../log/Logger.hpp"
+#include "../../../utils/MiscPrimitives.hpp"
 
 using std::string;
 
 namespace gene {
 
+// ‘=ACMGRSVTWYHKDBN’→ [0, 15], in either case, with anything else as N
+static constexpr std::array<uint8_t, 256> BaseNybbles() {
+    constexpr const char* bases = bmtls::kBases;
+    std::array<uint8_t, 256> nybbles{};
+    for (auto& nybble : nybbles)
+        nybble = 15;
+    for (uint8_t i = 0; i < 16; ++i) {
+        nybbles[static_cast<uint8_t>(bases[i])] = i;
+        if (bases[i] >= 'A' && bases[i] <= 'Z')
+            nybbles[static_cast<uint8_t>(bases[i] - 'A' + 'a')] = i;
+    }
+    return nybbles;
+}
+static constexpr std::array<uint8_t, 256> kBaseNybbles = BaseNybbles();
+
+static void AppendUint32(std::vector<uint8_t>& out, uint32_t value) {
+    out.resize(out.size() + sizeof(value));
+    bmtls::putUint32(out.data() + out.size() - sizeof(value), value);
+}
+
+static void AppendString(std::vector<uint8_t>& out, std::string_view str) {
+    out.insert(out.end(), str.begin(), str.end());
+}
+
 BamFile::BamFile(const std::string& path,
                  const std::unique_ptr<CommandLineFlags>& flags,
                  OpenMode mode)
-: AlignmentFile(path, FileType::Bam, flags, mode), BgzfFile(path, mode) {
+: AlignmentFile(path, FileType::Bam, flags, mode)
+, BgzfFile(path, mode, IoBackendFromFlags(flags),
+           flags->GetIntSetting(Flags::kDecompressionThreads),
+           flags->SettingExists(Flags::kVerifyChecksums)) {
     switch (mode) {
         case OpenMode::Read:
             ReadNextBlock();
             ReadSamHeader();
+            if (flags->SettingExists(Flags::kBuildIndex))
+                StartIndex_();
             break;
         case OpenMode::Write:
-            // Not supported
-            assert(false);
+            // Written along with the first record, which is also when the
+            // index is started. Only BGZF output can tell the offsets.
+            build_index_ = flags->SettingExists(Flags::kBuildIndex) &&
+                           dynamic_cast<BgzfStringOutputStream*>(out_file_.get());
             break;
     }
 }
 
-void BamFile::ReadSamHeader() {
-    const uint8_t* data = current_block->data();
-    int totalLengthInBytes = 0;
+BamFile::~BamFile() noexcept {
+    if (out_file_ && !header_written_)
+        WriteSamHeader_();
+    if (out_file_ && index_builder_) {
+        // Where the blocks start is only known once they're all written
+        auto& output = static_cast<BgzfStringOutputStream&>(*out_file_);
+        try {
+            output.Close();
+            index_builder_->TranslateOffsets([&output](uint64_t offset) {
+                return output.VirtualOffset(static_cast<int64_t>(offset));
+            });
+            index_complete_ = true;
+        } catch (const prim::UserVisibleError& error) {
+            PrintfLog("%s\n", error.what());
+        }
+    }
+    if (index_builder_ && index_complete_ && !index_builder_->Save(name_))
+        PrintfLog("Couldn't save index '%s'.\n", index_builder_->PathForFile(name_).c_str());
+}
 
-    char magic[5];
-    std::memcpy(magic, data, 4);
-    magic[4] = '\0';
-    if (std::strcmp(magic, "BAM\x01")) {
+bool BamFile::ReadHeaderBytes_(void* out, int64_t count) {
+    uint8_t* dest = static_cast<uint8_t*>(out);
+    while (count > 0) {
+        // Taken block by block, so nothing is carried over
+        if (block_offset_ >= current_block->size() && !ReadNextBlock())
+            return false;
+        const int64_t chunk = std::min<int64_t>(count, current_block->size() - block_offset_);
+        std::memcpy(dest, current_block->data() + block_offset_, chunk);
+        block_offset_ += static_cast<int32_t>(chunk);
+        dest += chunk;
+        count -= chunk;
+    }
+    return true;
+}
+
+bool BamFile::ReadHeaderInt_(int32_t& value) {
+    uint8_t bytes[sizeof(value)];
+    if (!ReadHeaderBytes_(bytes, sizeof(bytes)))
+        return false;
+    value = static_cast<int32_t>(bmtls::getUint32(bytes));
+    return true;
+}
+
+void BamFile::ReadSamHeader() {
+    // The header may span any number of blocks, e.g. with many @SQ lines
+    char magic[4];
+    if (!ReadHeaderBytes_(magic, sizeof(magic)) || std::memcmp(magic, "BAM\x01", sizeof(magic))) {
         // Corrupted file
         return;
     }
-    data += sizeof(magic) - 1;             // 0 (+ 4)
-    totalLengthInBytes += sizeof(magic) - 1;
 
-    int32_t l_text = bmtls::getUint32(data);
-    data += sizeof(l_text);             // 4 (+ 4)
-    totalLengthInBytes += sizeof(l_text);
+    auto damaged = [this] {
+        return prim::UserVisibleError("The header of '" + name_ + "' is damaged");
+    };
 
-    char* text = reinterpret_cast<char*>(malloc(l_text + 1));
-    std::memcpy(text, data, l_text);
-    text[l_text] = '\0';  // Quote: "...not necessarily NUL-terminated"
-    data += l_text;       // 4 (+ l_text)
-    totalLengthInBytes += l_text;
-    free(text);
+    int32_t l_text;
+    if (!ReadHeaderInt_(l_text) || l_text < 0)
+        throw damaged();
+    // Quote: "...not necessarily NUL-terminated"
+    std::string text(l_text, '\0');
+    if (!ReadHeaderBytes_(text.data(), l_text))
+        throw damaged();
+    text.resize(strnlen(text.data(), text.size()));
 
-    int32_t n_ref = bmtls::getUint32(data);
-    data += sizeof(n_ref);              // 4 + l_text (+ 4)
-    totalLengthInBytes += sizeof(n_ref);
+    int32_t n_ref;
+    if (!ReadHeaderInt_(n_ref) || n_ref < 0)
+        throw damaged();
 
     /* List of reference information (n = n_ref) */
     refs.resize(n_ref);
     for (int i = 0; i < n_ref; ++i) {
-        int32_t l_name = bmtls::getUint32(data);
-        data += sizeof(l_name);
-        totalLengthInBytes += sizeof(l_name);
-
-        char* name = reinterpret_cast<char*>(malloc(l_name));
-        std::memcpy(name, data, l_name);
-        data += l_name;
-        totalLengthInBytes += l_name;
-        refs[i].name.assign(name);
-        free(name);
-
-        int32_t l_ref = bmtls::getUint32(data);
-        data += sizeof(l_ref);
-        totalLengthInBytes += sizeof(l_ref);
-        refs[i].l_ref = l_ref;
+        int32_t l_name;
+        if (!ReadHeaderInt_(l_name) || l_name < 1)
+            throw damaged();
+        // NUL-terminated
+        refs[i].name.assign(l_name, '\0');
+        if (!ReadHeaderBytes_(refs[i].name.data(), l_name))
+            throw damaged();
+        refs[i].name.resize(strnlen(refs[i].name.data(), l_name));
+
+        if (!ReadHeaderInt_(refs[i].l_ref))
+            throw damaged();
+    }
+
+    std::vector<std::string> lines;
+    size_t line_start = 0;
+    while (line_start < text.size()) {
+        size_t line_end = std::min(text.find('\n', line_start), text.size());
+        if (line_end > line_start)
+            lines.push_back(text.substr(line_start, line_end - line_start));
+        line_start = line_end + 1;
     }
-    for (auto& ref : refs) {
-        ref.PrintDebug();
+    header = std::make_unique<SamHeader>(lines);
+
+    // The reference list is what BAM records refer to; the text may leave
+    // it out
+    if (header->sq.empty()) {
+        for (const auto& ref : refs) {
+            auto sq = std::make_unique<SamHeaderSQ>();
+            sq->SN = ref.name;
+            sq->LN = ref.l_ref;
+            header->sq.push_back(std::move(sq));
+        }
     }
-    block_offset_ += totalLengthInBytes;
-    return;
+}
+
+void BamFile::StartIndex_() {
+    int64_t max_length = 0;
+    for (const auto& ref : refs)
+        max_length = std::max<int64_t>(max_length, ref.l_ref);
+    index_builder_ = std::make_unique<BamIndex>(static_cast<int32_t>(refs.size()), max_length);
+}
+
+void BamFile::WriteSamHeader_() {
+    header_written_ = true;
+    if (!header)
+        header = std::make_unique<SamHeader>();
+
+    refs.clear();
+    ref_ids_.clear();
+    for (const auto& sq : header->sq) {
+        ref_ids_.emplace(sq->SN, static_cast<int32_t>(refs.size()));
+        refs.push_back({sq->SN, sq->LN});
+    }
+    if (build_index_)
+        StartIndex_();
+
+    std::vector<uint8_t>& out = record_buffer_;
+    const std::string text = header->text();
+    out.clear();
+    AppendString(out, "BAM\1");
+    AppendUint32(out, static_cast<uint32_t>(text.size()));
+    AppendString(out, text);
+    AppendUint32(out, static_cast<uint32_t>(refs.size()));
+    for (const auto& ref : refs) {
+        AppendUint32(out, static_cast<uint32_t>(ref.name.size() + 1));
+        AppendString(out, ref.name);
+        out.push_back(0);
+        AppendUint32(out, ref.l_ref);
+    }
+    out_file_->Write(std::string_view(reinterpret_cast<const char*>(out.data()), out.size()));
+}
+
+int32_t BamFile::ReferenceId_(const std::string& name) const {
+    if (name.empty() || name == "*")
+        return -1;
+
+    auto id = ref_ids_.find(name);
+    if (id == ref_ids_.end())
+        throw prim::UserVisibleError("Reference '" + name + "' isn't in the header of '" +
+                                     name_ + "'");
+    return id->second;
+}
+
+void BamFile::EncodeRecord_(const SamRecord& record) {
+    std::vector<uint8_t>& out = record_buffer_;
+    // block_size to tlen, filled in at the end
+    out.assign(36, 0);
+
+    // Decoded names come without the NUL, but one set by hand may still end
+    // in it
+    std::string_view read_name = record.QNAME;
+    if (!read_name.empty() && read_name.back() == '\0')
+        read_name.remove_suffix(1);
+    if (read_name.empty())
+        read_name = "*";
+    if (read_name.size() > 254)
+        throw prim::UserVisibleError("Read name '" + std::string(read_name) +
+                                     "' is longer than 254 characters");
+    AppendString(out, read_name);
+    out.push_back(0);
+
+    auto malformed = [read_name](const char* field) {
+        return prim::UserVisibleError(string("Malformed ") + field + " in read '" +
+                                      std::string(read_name) + "'");
+    };
+
+    const Cigar& cigar = record.CIGAR;
+    if (cigar.size() > UINT16_MAX)
+        throw malformed("CIGAR");
+    for (int32_t i = 0; i < cigar.size(); ++i)
+        AppendUint32(out, cigar[i]);
+
+    // 4-bit bases, the first one in the high nybble
+    const std::string& seq = record.SEQ;
+    const int32_t l_seq = seq == "*" ? 0 : static_cast<int32_t>(seq.size());
+    for (int32_t i = 0; i < l_seq; i += 2) {
+        uint8_t bases = kBaseNybbles[static_cast<uint8_t>(seq[i])] << 4;
+        if (i + 1 < l_seq)
+            bases |= kBaseNybbles[static_cast<uint8_t>(seq[i + 1])];
+        out.push_back(bases);
+    }
+
+    if (record.QUAL.empty() || record.QUAL == "*") {
+        out.insert(out.end(), l_seq, 0xFF);
+    } else {
+        if (record.QUAL.size() != static_cast<size_t>(l_seq))
+            throw malformed("QUAL");
+        for (char q : record.QUAL)
+            out.push_back(static_cast<uint8_t>(q - 33));
+    }
+
+    // Already in BAM layout
+    out.insert(out.end(), record.tag.data(), record.tag.data() + record.tag.size());
+
+    const int32_t ref_id = ReferenceId_(record.RNAME);
+    const int32_t next_ref_id = record.RNEXT == "=" ? ref_id : ReferenceId_(record.RNEXT);
+    const int32_t pos = record.POS - 1;
+    uint8_t* data = out.data();
+    bmtls::putUint32(data, static_cast<uint32_t>(out.size() - 4));
+    bmtls::putUint32(data + 4, ref_id);
+    bmtls::putUint32(data + 8, pos);
+    data[12] = static_cast<uint8_t>(read_name.size() + 1);
+    data[13] = static_cast<uint8_t>(record.MAPQ);
+    bmtls::putUint16(data + 16, static_cast<uint16_t>(cigar.size()));
+    bmtls::putUint16(data + 18, static_cast<uint16_t>(record.FLAG));
+    bmtls::putUint32(data + 20, l_seq);
+    bmtls::putUint32(data + 24, next_ref_id);
+    bmtls::putUint32(data + 28, record.PNEXT - 1);
+    bmtls::putUint32(data + 32, record.TLEN);
+    // Unplaced reads get the bin of [-1, 0), 4680
+    const int64_t end = pos >= 0 ? record.ReferenceEnd() : 0;
+    bmtls::putUint16(data + 14, static_cast<uint16_t>(BamIndex::RegionToBin(pos, end)));
 }
 
 void BamFile::write(const SamRecord& record) {
+    if (!header_written_)
+        WriteSamHeader_();
+
+    EncodeRecord_(record);
+    const int64_t address = out_file_->position();
+    out_file_->Write(std::string_view(reinterpret_cast<const char*>(record_buffer_.data()),
+                                      record_buffer_.size()));
+    if (index_builder_)
+        IndexRecord_(record_buffer_.data(), address, out_file_->position());
 }
 
-SamRecord BamFile::read() {
-    if (current_block_exhausted_) {
-        bool good = ReadNextBlock();
-        if (!good) {
-            return SamRecord();
+const uint8_t* BamFile::NextRecord_(uint64_t& address) {
+    while (true) {
+        if (current_block_exhausted_ && !ReadNextBlock()) {
+            // Not if the file ends within a record or at a damaged block
+            index_complete_ = !damaged_ && block_offset_ == current_block->size();
+            return nullptr;
         }
+
+        // Records which don't fit into what is left of the block are read
+        // again once the next block has been appended
+        const int32_t size = current_block->size();
+        if (block_offset_ + 4 <= size) {
+            const uint8_t* data = current_block->data() + block_offset_;
+            const int32_t block_size = bmtls::getUint32(data);
+            if (block_offset_ + 4 + block_size <= size) {
+                address = Tell();
+                block_offset_ += 4 + block_size;
+                if (index_builder_)
+                    IndexRecord_(data, address, Tell());
+                return data;
+            }
+        }
+        current_block_exhausted_ = true;
     }
+}
 
-    SamRecord record;
-    const uint8_t* data = current_block->data() + block_offset_;
+void BamFile::IndexRecord_(const uint8_t* data, uint64_t address, uint64_t end_address) {
+    const BamRecordView record(data);
+    const int32_t ref_id = record.ref_id();
+    const int32_t pos = record.pos();
 
-    int32_t size = current_block->size();
-    if (block_offset_ + 4 > size) {
-        current_block_exhausted_ = true;
-        return read();
+    // Placed records have to be sorted, and come before unplaced ones
+    if (ref_id >= 0 && (last_ref_id_ < 0 || ref_id < last_ref_id_ ||
+                        (ref_id == last_ref_id_ && pos < last_pos_))) {
+        PrintfLog("'%s' isn't sorted by coordinate, so it can't be indexed.\n", name_.c_str());
+        index_builder_.reset();
+        return;
     }
-    // std::cout << "Block size: " << currentBlock->size() <<
-    // " Block offset: " << blockOffset_ << '\n';
-    int total_read_bytes = 0;
-    int read_bytes_so_far = 0;
+    last_ref_id_ = ref_id;
+    last_pos_ = pos;
 
-    // 0 (+ 4) Length of the remainder of the alignment record
-    int32_t block_size = bmtls::getUint32(data);
+    const int64_t end = ref_id >= 0 ? record.reference_end() : 0;
+    index_builder_->AddRecord(ref_id, pos, end, !(record.flag() & 4), address, end_address);
+}
 
-    if (block_offset_ + block_size + 4 > size) {
-        current_block_exhausted_ = true;
-        return read();
+const uint8_t* BamFile::NextQueryRecord_() {
+    QueryState& query = *query_;
+    while (query.chunk < query.chunks.size()) {
+        uint64_t address;
+        const uint8_t* data = NextRecord_(address);
+        if (!data || address >= query.chunks[query.chunk].end) {
+            // On to the next chunk
+            if (++query.chunk < query.chunks.size() &&
+                !BgzfFile::Seek(query.chunks[query.chunk].begin, query.chunks[query.chunk].end))
+                break;
+            continue;
+        }
+
+        // Records are sorted, so none of the following ones overlap either
+        const BamRecordView record(data);
+        if (record.ref_id() != query.ref_id || record.pos() >= query.end)
+            break;
+
+        if (record.reference_end() > query.begin)
+            return data;
     }
+    query.chunk = query.chunks.size();
+    return nullptr;
+}
 
-    data += sizeof(block_size);
-    read_bytes_so_far += sizeof(block_size);
-
-    int32_t refId = bmtls::getUint32(data);         // 4 (+ 4)
-    data += sizeof(refId);
-    read_bytes_so_far += sizeof(refId);
-    record.RNAME = refs[refId].name;
-
-    record.POS = bmtls::getUint32(data) + 1;           // 8 (+ 4)
-    data += sizeof(record.POS);
-    read_bytes_so_far += sizeof(record.POS);
-
-    uint32_t bin_mq_nl = bmtls::getUint32(data);     // 12 (+ 4)
-    data += sizeof(bin_mq_nl);
-    uint8_t l_read_name = bin_mq_nl & 0x000000FF;
-    record.MAPQ = (bin_mq_nl & 0x0000FF00) >> 8;
-    // uint16_t bin = (bin_mq_nl & 0xFFFF0000) >> 16;
-    read_bytes_so_far += sizeof(bin_mq_nl);
-
-    uint32_t flag_nc = bmtls::getUint32(data);       // 16 (+ 4)
-    data += sizeof(flag_nc);
-    record.FLAG = flag_nc >> 16;
-    uint16_t n_cigar_op = flag_nc & 0xFFFF;
-    read_bytes_so_far += sizeof(flag_nc);
-
-    uint32_t l_seq = bmtls::getUint32(data);         // 20 (+ 4)
-    data += sizeof(l_seq);
-    read_bytes_so_far += sizeof(l_seq);
-
-    int32_t next_refId = bmtls::getUint32(data);    // 24 (+ 4)
-    data += sizeof(next_refId);
-    read_bytes_so_far += sizeof(next_refId);
-
-    record.PNEXT = bmtls::getUint32(data) + 1;      // 28 (+ 4)
-    data += sizeof(record.PNEXT);
-    read_bytes_so_far += sizeof(record.PNEXT);
-
-    int32_t tlen = bmtls::getUint32(data);          // 32 (+ 4)
-    data += sizeof(tlen);
-    read_bytes_so_far += sizeof(tlen);
-
-    // 36 (+ l_read_name)
-    std::vector<uint8_t> read_name(l_read_name);
-    std::memcpy(read_name.data(), data, l_read_name);
-    data += l_read_name;
-    read_bytes_so_far += l_read_name;
-    record.QNAME.assign(read_name.data(), read_name.data() + l_read_name);
-
-    std::vector<uint32_t> cigar(n_cigar_op);
-    std::memcpy(cigar.data(), data, n_cigar_op*sizeof(uint32_t));
-    data += n_cigar_op*sizeof(uint32_t);
-    read_bytes_so_far += n_cigar_op*sizeof(uint32_t);
-
-    auto intToOp = [](uint8_t byte) -> char {
-        // ‘MIDNSHP=X’→‘012345678’
-        switch (byte & 0xF) {
-            case 0:
-                return 'M';
-            case 1:
-                return 'I';
-            case 2:
-                return 'D';
-            case 3:
-                return 'N';
-            case 4:
-                return 'S';
-            case 5:
-                return 'H';
-            case 6:
-                return 'P';
-            case 7:
-                return '=';
-            case 8:
-                return 'X';
-            default:
-                return 0;
-                // Impossible operation code
-                // cassert(false);
+bool BamFile::Query(const std::string& ref_name, int64_t begin, int64_t end) {
+    auto ref = std::find_if(refs.begin(), refs.end(), [&ref_name](const ReferenceInfo& info) {
+        return info.name == ref_name;
+    });
+    if (ref == refs.end())
+        return false;
+
+    // Records are skipped from now on, so an index being built would be
+    // incomplete. One that is complete already is as good as a loaded one.
+    if (index_builder_ && !index_complete_)
+        index_builder_.reset();
+    const BamIndex* index = index_builder_ ? index_builder_.get() : index_.get();
+    if (!index) {
+        index_ = BamIndex::Load(name_);
+        if (!index_) {
+            PrintfLog("Couldn't load a .bai index for '%s'.\n", name_.c_str());
+            return false;
         }
-    };
+        index = index_.get();
+    }
+
+    query_ = std::make_unique<QueryState>();
+    query_->ref_id = static_cast<int32_t>(ref - refs.begin());
+    query_->begin = begin;
+    query_->end = end;
+    query_->chunks = index->Chunks(query_->ref_id, begin, end);
+    query_->chunk = 0;
+    if (!query_->chunks.empty() &&
+        !BgzfFile::Seek(query_->chunks.front().begin, query_->chunks.front().end))
+        query_->chunk = query_->chunks.size();
+    return true;
+}
+
+std::vector<std::unique_ptr<BamFile>> BamFile::Shards(
+    const std::string& path,
+    const std::unique_ptr<CommandLineFlags>& flags,
+    int count) {
+    // Where the shards start is found on a file of its own, inflating just
+    // the blocks needed for that
+    auto probe_flags = std::make_unique<CommandLineFlags>(*flags);
+    probe_flags->SetSetting(Flags::kDecompressionThreads, 1);
+    BamFile probe(path, probe_flags, OpenMode::Read);
+    probe.index_builder_.reset();
+
+    std::vector<uint64_t> starts{probe.Tell()};
+    for (int i = 1; i < count; ++i) {
+        uint64_t start = probe.FindRecordStart_(probe.length() / count * i);
+        if (start == UINT64_MAX)
+            break;
+        // Not before the first record, in case the header spans more blocks
+        start = std::max(start, starts.front());
+        if (start > starts.back())
+            starts.push_back(start);
+    }
+    starts.push_back(UINT64_MAX);
+
+    const int shard_count = static_cast<int>(starts.size()) - 1;
+    int threads = flags->GetIntSetting(Flags::kDecompressionThreads);
+    if (threads <= 0)
+        threads = std::thread::hardware_concurrency();
+    auto shard_flags = std::make_unique<CommandLineFlags>(*flags);
+    shard_flags->SetSetting(Flags::kDecompressionThreads, std::max(threads / shard_count, 1));
+
+    std::vector<std::unique_ptr<BamFile>> shards;
+    for (int i = 0; i < shard_count; ++i) {
+        auto shard = std::make_unique<BamFile>(path, shard_flags, OpenMode::Read);
+        shard->index_builder_.reset();
+        shard->end_offset_ = starts[i + 1];
+        if (!shard->BgzfFile::Seek(starts[i], starts[i + 1]))
+            throw prim::UserVisibleError("Couldn't split '" + path + "' into parts");
+        shards.push_back(std::move(shard));
+    }
+    return shards;
+}
 
-    auto getCigarString = [&record, cigar, n_cigar_op, &intToOp]() {
-        for (int i = 0; i < n_cigar_op; ++i) {
-            record.CIGAR += std::to_string(cigar[i] >> 4);
-            record.CIGAR += intToOp(cigar[i]);
+uint64_t BamFile::FindRecordStart_(int64_t offset) {
+    // There's a block starting within every kBgzfMaxBlockSize bytes. Where
+    // a header seems to start, it's taken to be one if it's followed by
+    // another one or the end of the file.
+    std::vector<uint8_t> window(2 * kBgzfMaxBlockSize + kBgzfBlockHeaderSize);
+    if (!input_->Seek(offset))
+        return UINT64_MAX;
+    const int64_t read = input_->Read(window.data(), window.size());
+    int64_t block = -1;
+    for (int64_t i = 0; i <= kBgzfMaxBlockSize && i + kBgzfBlockHeaderSize <= read; ++i) {
+        const int32_t size = BgzfBlock::CompressedBlockSize(window.data() + i);
+        if (size < 0)
+            continue;
+        const int64_t next = i + size;
+        if (offset + next == length() ||
+            (next + kBgzfBlockHeaderSize <= read &&
+             BgzfBlock::CompressedBlockSize(window.data() + next) > 0)) {
+            block = offset + i;
+            break;
         }
-    };
-    getCigarString();
-
-    std::vector<uint8_t> seq((l_seq + 1)/2);
-    std::memcpy(seq.data(), data, (l_seq + 1)/2);
-    data += (l_seq+1)/2;
-    read_bytes_so_far += (l_seq+1)/2;
-
-    record.SEQ.resize(l_seq);
-    auto nybbleToBase = [](uint8_t byte) -> char {
-        // ‘=ACMGRSVTWYHKDBN’→ [0, 15]
-        switch (byte & 0x0F) {
-            case 0:
-                return '=';
-            case 1:
-                return 'A';
-            case 2:
-                return 'C';
-            case 3:
-                return 'M';
-            case 4:
-                return 'G';
-            case 5:
-                return 'R';
-            case 6:
-                return 'S';
-            case 7:
-                return 'V';
-            case 8:
-                return 'T';
-            case 9:
-                return 'W';
-            case 10:
-                return 'Y';
-            case 11:
-                return 'H';
-            case 12:
-                return 'K';
-            case 13:
-                return 'D';
-            case 14:
-                return 'B';
-            case 15:
-                return 'N';
-            default:
-                return 'N';
+    }
+    if (block < 0)
+        return UINT64_MAX;
+
+    // A record continued from the blocks before may take up all of one
+    while (block < length()) {
+        const uint64_t address = static_cast<uint64_t>(block) << 16;
+        if (!BgzfFile::Seek(address, address))
+            return UINT64_MAX;
+
+        const uint8_t* data = current_block->data() + block_offset_;
+        const int32_t size = current_block->size() - block_offset_;
+        for (int32_t i = 0; i < size; ++i) {
+            if (LooksLikeRecords_(data + i, size - i))
+                return address | static_cast<uint64_t>(i);
         }
-    };
-
-    for (int i = 0; i < (l_seq+1)/2; ++i) {
-        record.SEQ[i*2] = nybbleToBase(seq[i] >> 4);
-        record.SEQ[i*2 + 1] = nybbleToBase(seq[i]);
+        block = position();
     }
+    return UINT64_MAX;
+}
 
-    std::vector<uint8_t> qual(l_seq + 1);
-    std::memcpy(qual.data(), data, l_seq);
-    data += l_seq;
-    read_bytes_so_far += l_seq;
-    if (l_seq > 1 && qual[0] != 0xFF) {
-        std::for_each(qual.begin(), qual.end(), [](uint8_t& q){q += 33;});
-        record.QUAL.assign(qual.data(), qual.data() + l_seq);
-    } else {
-        record.QUAL = '*';
+bool BamFile::LooksLikeRecords_(const uint8_t* data, int64_t available) const noexcept {
+    const int32_t ref_count = static_cast<int32_t>(refs.size());
+    bool first = true;
+    // Only records whose read name is all there can be checked
+    while (available >= 36 && available >= 36 + data[12]) {
+        const BamRecordView record(data);
+        const int32_t block_size = bmtls::getUint32(data);
+        const int32_t ref_id = record.ref_id();
+        const int32_t next_ref_id = record.next_ref_id();
+        const int32_t l_read_name = record.l_read_name();
+        const int64_t l_seq = record.l_seq();
+        if (ref_id < -1 || ref_id >= ref_count || next_ref_id < -1 || next_ref_id >= ref_count)
+            return false;
+        if (record.pos() < -1 || (ref_id >= 0 && record.pos() > refs[ref_id].l_ref) ||
+            record.next_pos() < -1)
+            return false;
+        if (l_read_name < 2 || l_seq < 0 ||
+            block_size < 32 + l_read_name + 4 * record.n_cigar_op() + (l_seq + 1) / 2 + l_seq)
+            return false;
+
+        // [!-?A-~]{1,254}, NUL-terminated
+        const uint8_t* name = data + 36;
+        if (name[l_read_name - 1] != '\0')
+            return false;
+        for (int32_t i = 0; i < l_read_name - 1; ++i) {
+            if (name[i] < '!' || name[i] > '~' || name[i] == '@')
+                return false;
+        }
+
+        first = false;
+        data += 4 + static_cast<int64_t>(block_size);
+        available -= 4 + static_cast<int64_t>(block_size);
     }
+    return !first;
+}
 
-    /* Auxillary data (unti the end of alignment block) */
-    int32_t tag_length = block_size - read_bytes_so_far + 4;
-    if (block_size > read_bytes_so_far) {
-        int32_t tag_size = record.tag.readTag(current_block->data() +
-                                              block_offset_,
-                                              tag_length);
-        read_bytes_so_far += tag_size;
-        data += tag_size;
-    } else {
-        data += (block_size - read_bytes_so_far) + 4;
-        total_read_bytes += tag_length;
+uint64_t BamFile::Tell() const noexcept {
+    assert(!out_file_);
+    return BgzfFile::Tell();
+}
+
+bool BamFile::Seek(uint64_t virtual_offset) {
+    assert(!out_file_);
+    query_.reset();
+    // Records may be skipped or read twice from now on
+    if (index_builder_ && !index_complete_)
+        index_builder_.reset();
+    return BgzfFile::Seek(virtual_offset);
+}
+
+void BamFile::SetProjection(uint32_t fields) noexcept {
+    fields_ = (fields & kAllFields) | kQname;
+}
+
+void BamFile::SetFilter(const BamRecordFilter& filter) noexcept {
+    filter_ = filter;
+    filtering_ = !filter.AcceptsAll();
+}
+
+BamRecordView BamFile::NextUnfilteredView_() {
+    if (query_)
+        return BamRecordView(NextQueryRecord_());
+    if (end_offset_ != UINT64_MAX && Tell() >= end_offset_)
+        return BamRecordView();
+
+    uint64_t address;
+    return BamRecordView(NextRecord_(address));
+}
+
+BamRecordView BamFile::NextView() {
+    BamRecordView view = NextUnfilteredView_();
+    if (filtering_) {
+        while (view && !filter_.Accepts(view))
+            view = NextUnfilteredView_();
     }
-    if (block_offset_ + read_bytes_so_far > size) {
-        block_offset_ += block_size;
+    return view;
+}
+
+const std::string& BamFile::ReferenceName(int32_t ref_id) const {
+    static const std::string kUnplaced = "*";
+    return ref_id >= 0 && ref_id < static_cast<int32_t>(refs.size()) ? refs[ref_id].name
+                                                                      : kUnplaced;
+}
+
+SamRecord BamFile::read() {
+    BamRecordView view = NextView();
+    return view ? DecodeRecord_(view) : SamRecord();
+}
+
+SamRecord BamFile::DecodeRecord_(const BamRecordView& view) const {
+    SamRecord record;
+    record.QNAME = view.read_name();
+    if (fields_ & kFlag)
+        record.FLAG = view.flag();
+    if (fields_ & kRname)
+        record.RNAME = ReferenceName(view.ref_id());
+    if (fields_ & kPos)
+        record.POS = view.pos() + 1;
+    if (fields_ & kMapq)
+        record.MAPQ = view.mapq();
+    if (fields_ & kCigar)
+        view.DecodeCigar(record.CIGAR);
+
+    if (fields_ & kRnext) {
+        const int32_t next_ref_id = view.next_ref_id();
+        if (next_ref_id >= 0 && next_ref_id == view.ref_id())
+            record.RNEXT = "=";
+        else
+            record.RNEXT = ReferenceName(next_ref_id);
     }
-    block_offset_ += read_bytes_so_far;
+    if (fields_ & kPnext)
+        record.PNEXT = view.next_pos() + 1;
+    if (fields_ & kTlen)
+        record.TLEN = view.tlen();
+
+    if (fields_ & kSeq)
+        view.DecodeSequence(record.SEQ);
+    if (fields_ & kQual)
+        view.DecodeQuality(record.QUAL);
+
+    if ((fields_ & kTags) && view.aux_size() > 0)
+        record.tag.readTag(view.aux_data(), view.aux_size());
     return record;
 }
 
 int64_t BamFile::position() const
 {
+    if (out_file_)
+        return out_file_->position();
     return BgzfFile::position();
 }
 
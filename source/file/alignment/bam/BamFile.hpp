@@ -21,8 +21,13 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <iterator>
+#include <cstddef>
 
 #include "../AlignmentFile.hpp"
+#include "BamIndex.hpp"
+#include "BamRecordView.hpp"
 #include "../sam/SamHeader.hpp"
 #include "../../../io/BgzfFile.hpp"
 
@@ -44,23 +49,190 @@ class BamFile : public AlignmentFile, BgzfFile {
         }
     };
 
+    // Region read() is restricted to by Query()
+    struct QueryState {
+        int32_t ref_id;
+        int64_t begin;
+        int64_t end;
+        std::vector<BamIndex::Chunk> chunks;
+        size_t chunk;
+    };
+
     void ReadSamHeader();
+    // Copy the next bytes of the header, reading blocks as needed. False if
+    // the file ends first.
+    bool ReadHeaderBytes_(void* out, int64_t count);
+    bool ReadHeaderInt_(int32_t& value);
     std::vector<ReferenceInfo> refs;
 
+    // Returns the next record, starting with its block_size, and moves past
+    // it, or nullptr at the end of the file. 'address' is set to its virtual
+    // offset. The record is valid until the next call.
+    const uint8_t* NextRecord_(uint64_t& address);
+    // Same for the next record overlapping the query region
+    const uint8_t* NextQueryRecord_();
+    // NextRecord_() or NextQueryRecord_(), up to 'end_offset_'
+    BamRecordView NextUnfilteredView_();
+    // Decodes the fields in 'fields_'
+    SamRecord DecodeRecord_(const BamRecordView& view) const;
+
+    BamRecordFilter filter_;
+    bool filtering_{false};
+    uint32_t fields_{kAllFields};
+    // Virtual offset of the first record of the next shard, if this is one
+    uint64_t end_offset_{UINT64_MAX};
+
+    // Virtual offset of the first record starting in one of the blocks at or
+    // after compressed offset 'offset', or UINT64_MAX if there's none
+    uint64_t FindRecordStart_(int64_t offset);
+    // Whether 'data' looks like the start of a record, and so do the ones
+    // after it which start within 'available' bytes
+    bool LooksLikeRecords_(const uint8_t* data, int64_t available) const noexcept;
+
+    std::unique_ptr<BamIndex> index_;
+    std::unique_ptr<QueryState> query_;
+
+    // Index built while the file is read from start to end or written,
+    // saved by the destructor once it's complete. When writing, records are
+    // added at their offsets in the uncompressed output, which are turned
+    // into virtual offsets once all blocks have been compressed.
+    void StartIndex_();
+    void IndexRecord_(const uint8_t* data, uint64_t address, uint64_t end_address);
+    std::unique_ptr<BamIndex> index_builder_;
+    bool index_complete_{false};
+    bool build_index_{false};
+    int32_t last_ref_id_{0};
+    int32_t last_pos_{0};
+
+    // Write mode. The header is written with the first record (or when the
+    // file is closed without any), so that 'header' can be filled in first.
+    void WriteSamHeader_();
+    int32_t ReferenceId_(const std::string& name) const;
+    // Packs 'record' into 'record_buffer_'
+    void EncodeRecord_(const SamRecord& record);
+    std::unordered_map<std::string, int32_t> ref_ids_;
+    std::vector<uint8_t> record_buffer_;
+    bool header_written_{false};
+
  public:
     BamFile(const std::string& path,
             const std::unique_ptr<CommandLineFlags>& flags,
             OpenMode Mode);
+    ~BamFile() noexcept override;
 
     std::string strFileType() const override;
     bool isValidAlignmentFile() const override;
 
+    // SamRecord fields read() decodes, or'ed together
+    enum Field : uint32_t {
+        kQname = 1 << 0,
+        kFlag = 1 << 1,
+        kRname = 1 << 2,
+        kPos = 1 << 3,
+        kMapq = 1 << 4,
+        kCigar = 1 << 5,
+        kRnext = 1 << 6,
+        kPnext = 1 << 7,
+        kTlen = 1 << 8,
+        kSeq = 1 << 9,
+        kQual = 1 << 10,
+        kTags = 1 << 11,
+        kAllFields = (1 << 12) - 1
+    };
+    // Makes read() decode only 'fields' (kAllFields by default). The others
+    // are left empty, or 0 for the numeric ones. QNAME is always decoded, as
+    // an empty one marks the end of the file.
+    void SetProjection(uint32_t fields) noexcept;
+    // Makes read() and the views skip records 'filter' doesn't accept. Only
+    // their fixed fields are looked at to tell.
+    void SetFilter(const BamRecordFilter& filter) noexcept;
+
+    // Input iterator over the records read() would return, as views into
+    // the inflated blocks: only valid until the iterator is advanced
+    class RecordIterator {
+     public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = BamRecordView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const BamRecordView*;
+        using reference = const BamRecordView&;
+
+        RecordIterator() = default;
+        explicit RecordIterator(BamFile* file) : file_(file), record_(file->NextView()) {}
+
+        reference operator*() const noexcept { return record_; }
+        pointer operator->() const noexcept { return &record_; }
+        RecordIterator& operator++() {
+            record_ = file_->NextView();
+            return *this;
+        }
+        bool operator==(const RecordIterator& other) const noexcept {
+            return record_.data() == other.record_.data();
+        }
+        bool operator!=(const RecordIterator& other) const noexcept {
+            return !(*this == other);
+        }
+
+     private:
+        BamFile* file_{nullptr};
+        BamRecordView record_;
+    };
+
+    struct RecordRange {
+        BamFile* file;
+        RecordIterator begin() const { return RecordIterator(file); }
+        RecordIterator end() const { return RecordIterator(); }
+    };
+
     SamRecord read() override;
+    // Same as read() without decoding anything: the view is empty at the end
+    // and valid until the next read
+    BamRecordView NextView();
+    // for (const BamRecordView& record : bam.Records()) ...
+    RecordRange Records() { return RecordRange{this}; }
+
+    // RNAME of records with 'ref_id', "*" for -1
+    const std::string& ReferenceName(int32_t ref_id) const;
+    // Appends 'record' in binary form. RNAME and RNEXT have to be "*" or
+    // the name of one of the @SQ lines in 'header', which also define the
+    // reference list of the file. Blocks are compressed on
+    // --compression-threads workers.
     void write(const SamRecord& record) override;
 
+    // Restricts read() to the records overlapping [begin, end) on reference
+    // 'ref_name', using the index next to the file (or the one built while
+    // reading it with --build-index) to skip to them.
+    // Positions are 0-based, i.e. POS - 1. Returns false if there's no index
+    // or no such reference.
+    bool Query(const std::string& ref_name, int64_t begin, int64_t end);
+
+    // Splits the records of the BAM file at 'path' into up to 'count' runs
+    // of about the same compressed size, each read by a BamFile of its own
+    // with --decompression-threads shared out between them, so they can be
+    // processed on separate threads. No index is needed: each run starts at
+    // the first block after its share of the file, with the first record in
+    // there found by checking the fixed fields of candidates against the
+    // reference list.
+    static std::vector<std::unique_ptr<BamFile>> Shards(
+        const std::string& path,
+        const std::unique_ptr<CommandLineFlags>& flags,
+        int count);
+
+    // Virtual offset of the record read() returns next (compressed offset of
+    // its block << 16 | offset within the inflated block), to resume reading
+    // from with Seek(), even in a later run
+    uint64_t Tell() const noexcept;
+    // Makes read() continue with the record at 'virtual_offset', which has
+    // to come from Tell() or an index. Ends any Query(). Returns false if
+    // there's no such offset.
+    bool Seek(uint64_t virtual_offset);
+
     static std::string defaultExtension();
     static std::vector<std::string> extensions();
 
+    // Parsed from the header text when reading, with @SQ lines added from
+    // the reference list if the text has none. Has to be set before the
+    // first write() when writing.
     std::unique_ptr<SamHeader> header;
 
     int64_t position() const override;
@@ -0,0 +1,543 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "BamIndex.hpp"
+#include "BamUtils.hpp"
+#include "../../../io/BgzfReader.hpp"
+#include "../../../io/backends/IoBackend.hpp"
+#include "../../../io/streams/BgzfStringOutputStream.hpp"
+#include "../../../utils/MiscPrimitives.hpp"
+#include "../../../utils/StringUtils.hpp"
+
+namespace gene {
+
+static const char kBaiMagic[4] = {'B', 'A', 'I', '\1'};
+static const char kCsiMagic[4] = {'C', 'S', 'I', '\1'};
+
+namespace {
+
+// Bounds-checked little-endian reads from the index file contents
+class IndexReader {
+ public:
+    explicit IndexReader(const std::vector<uint8_t>& data)
+    : data_(data)
+    {
+    }
+
+    bool ReadInt32(int32_t& value)
+    {
+        if (!Has(4))
+            return false;
+        value = static_cast<int32_t>(bmtls::getUint32(data_.data() + offset_));
+        offset_ += 4;
+        return true;
+    }
+
+    bool ReadUint32(uint32_t& value)
+    {
+        if (!Has(4))
+            return false;
+        value = bmtls::getUint32(data_.data() + offset_);
+        offset_ += 4;
+        return true;
+    }
+
+    bool ReadUint64(uint64_t& value)
+    {
+        if (!Has(8))
+            return false;
+        value = bmtls::getUint64(data_.data() + offset_);
+        offset_ += 8;
+        return true;
+    }
+
+    bool Skip(size_t size)
+    {
+        if (!Has(size))
+            return false;
+        offset_ += size;
+        return true;
+    }
+
+    bool Has(size_t size) const noexcept
+    {
+        return data_.size() - offset_ >= size;
+    }
+
+ private:
+    const std::vector<uint8_t>& data_;
+    size_t offset_{0};
+};
+
+// Little-endian writes for saving
+class IndexWriter {
+ public:
+    void WriteInt32(int32_t value)
+    {
+        WriteUint32(static_cast<uint32_t>(value));
+    }
+
+    void WriteUint32(uint32_t value)
+    {
+        uint8_t bytes[4];
+        bmtls::putUint32(bytes, value);
+        data_.append(reinterpret_cast<const char *>(bytes), sizeof(bytes));
+    }
+
+    void WriteUint64(uint64_t value)
+    {
+        uint8_t bytes[8];
+        bmtls::putUint64(bytes, value);
+        data_.append(reinterpret_cast<const char *>(bytes), sizeof(bytes));
+    }
+
+    void WriteBytes(const char *bytes, size_t size)
+    {
+        data_.append(bytes, size);
+    }
+
+    const std::string& data() const noexcept
+    {
+        return data_;
+    }
+
+ private:
+    std::string data_;
+};
+
+bool ReadWholeFile(const std::string& path, std::vector<uint8_t>& data)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    uint8_t buffer[1 << 16];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+        data.insert(data.end(), buffer, buffer + read);
+    bool good = !ferror(file);
+    fclose(file);
+    return good;
+}
+
+// CSI files are BGZF-compressed
+bool InflateBgzf(const std::string& path, std::vector<uint8_t>& data)
+{
+    auto input = InputBackend::Open(path, IoBackend::Stdio);
+    BgzfReader reader(*input, 1);
+    BgzfReader::Block block;
+    data.clear();
+    while (reader.Next(block))
+        data.insert(data.end(), block.data, block.data + block.size);
+    return !data.empty();
+}
+
+// Bins are numbered level by level, starting with the root
+uint32_t FirstBinOfLevel(int level)
+{
+    return ((1u << level * 3) - 1) / 7;
+}
+
+}  // namespace
+
+std::vector<std::string> BamIndex::PathsForFile(const std::string& bam_path)
+{
+    std::vector<std::string> paths = {bam_path + ".bai"};
+    if (utils::HasExtension(bam_path, "bam"))
+        paths.push_back(bam_path.substr(0, bam_path.size() - 3) + "bai");
+    paths.push_back(bam_path + ".csi");
+    return paths;
+}
+
+std::unique_ptr<BamIndex> BamIndex::Load(const std::string& bam_path)
+{
+    for (const auto& path : PathsForFile(bam_path)) {
+        if (auto index = LoadFile(path))
+            return index;
+    }
+    return nullptr;
+}
+
+std::unique_ptr<BamIndex> BamIndex::LoadFile(const std::string& index_path)
+{
+    std::vector<uint8_t> data;
+    if (!ReadWholeFile(index_path, data))
+        return nullptr;
+
+    if (data.size() >= 2 && data[0] == 31 && data[1] == 139) {
+        try {
+            if (!InflateBgzf(index_path, data))
+                return nullptr;
+        } catch (const prim::UserVisibleError&) {
+            return nullptr;
+        }
+    }
+    return Parse_(data);
+}
+
+std::unique_ptr<BamIndex> BamIndex::Parse_(const std::vector<uint8_t>& data)
+{
+    if (data.size() < sizeof(kBaiMagic))
+        return nullptr;
+
+    auto index = std::unique_ptr<BamIndex>(new BamIndex());
+    IndexReader reader(data);
+    reader.Skip(sizeof(kBaiMagic));
+    if (std::memcmp(data.data(), kCsiMagic, sizeof(kCsiMagic)) == 0) {
+        int32_t l_aux;
+        index->csi_ = true;
+        if (!reader.ReadInt32(index->min_shift_) || !reader.ReadInt32(index->depth_) ||
+            index->min_shift_ < 1 || index->depth_ < 1 || index->min_shift_ + 3 * index->depth_ > 62 ||
+            !reader.ReadInt32(l_aux) || l_aux < 0 || !reader.Skip(l_aux))
+            return nullptr;
+    } else if (std::memcmp(data.data(), kBaiMagic, sizeof(kBaiMagic)) != 0) {
+        return nullptr;
+    }
+
+    int32_t n_ref;
+    if (!reader.ReadInt32(n_ref) || n_ref < 0)
+        return nullptr;
+
+    const uint32_t metadata_bin = index->MetadataBin_();
+    index->references_.resize(n_ref);
+    for (auto& reference : index->references_) {
+        int32_t n_bin;
+        if (!reader.ReadInt32(n_bin) || n_bin < 0)
+            return nullptr;
+
+        for (int32_t i = 0; i < n_bin; ++i) {
+            uint32_t number;
+            uint64_t loffset = 0;
+            int32_t n_chunk;
+            if (!reader.ReadUint32(number) ||
+                (index->csi_ && !reader.ReadUint64(loffset)) ||
+                !reader.ReadInt32(n_chunk) || n_chunk < 0 ||
+                !reader.Has(static_cast<size_t>(n_chunk) * 16))
+                return nullptr;
+
+            std::vector<Chunk> chunks(n_chunk);
+            for (auto& chunk : chunks) {
+                reader.ReadUint64(chunk.begin);
+                reader.ReadUint64(chunk.end);
+            }
+            if (number == metadata_bin && chunks.size() == 2) {
+                reference.begin_address = chunks[0].begin;
+                reference.end_address = chunks[0].end;
+                reference.mapped = chunks[1].begin;
+                reference.unmapped = chunks[1].end;
+                continue;
+            }
+            Bin& bin = reference.bins[number];
+            bin.loffset = loffset;
+            bin.chunks = std::move(chunks);
+        }
+
+        if (index->csi_)
+            continue;
+
+        int32_t n_intv;
+        if (!reader.ReadInt32(n_intv) || n_intv < 0 ||
+            !reader.Has(static_cast<size_t>(n_intv) * 8))
+            return nullptr;
+
+        reference.intervals.resize(n_intv);
+        for (auto& offset : reference.intervals)
+            reader.ReadUint64(offset);
+    }
+
+    // Optional
+    reader.ReadUint64(index->unplaced_);
+    return index;
+}
+
+BamIndex::BamIndex(int32_t n_ref, int64_t max_length)
+: references_(std::max(n_ref, 0))
+{
+    // BAI covers references up to 2^29 bp. CSI gets as many levels as
+    // needed, the way samtools picks them.
+    if (max_length + 256 > MaxPosition_()) {
+        csi_ = true;
+        depth_ = 0;
+        for (int64_t size = int64_t(1) << min_shift_; max_length + 256 > size; size <<= 3)
+            depth_++;
+    }
+}
+
+uint32_t BamIndex::RegionToBin(int64_t begin, int64_t end, int min_shift, int depth) noexcept
+{
+    --end;
+    int shift = min_shift;
+    for (int level = depth; level > 0; --level, shift += 3) {
+        if (begin >> shift == end >> shift)
+            return static_cast<uint32_t>(FirstBinOfLevel(level) + (begin >> shift));
+    }
+    return 0;
+}
+
+std::vector<uint32_t> BamIndex::RegionToBins(int64_t begin, int64_t end, int min_shift, int depth)
+{
+    std::vector<uint32_t> bins;
+    --end;
+    int shift = min_shift + depth * 3;
+    for (int level = 0; level <= depth; ++level, shift -= 3) {
+        const uint32_t first = FirstBinOfLevel(level);
+        for (int64_t k = first + (begin >> shift); k <= first + (end >> shift); ++k)
+            bins.push_back(static_cast<uint32_t>(k));
+    }
+    return bins;
+}
+
+uint32_t BamIndex::MetadataBin_() const noexcept
+{
+    return FirstBinOfLevel(depth_ + 1) + 1;
+}
+
+int64_t BamIndex::MaxPosition_() const noexcept
+{
+    return int64_t(1) << (min_shift_ + depth_ * 3);
+}
+
+uint64_t BamIndex::LinearOffset_(const Reference& reference, int64_t position) const
+{
+    if (reference.intervals.empty())
+        return 0;
+
+    // Windows without records were filled with UINT64_MAX while building.
+    // The one before them bounds the records overlapping them as well.
+    size_t window = std::min<size_t>(position >> min_shift_, reference.intervals.size() - 1);
+    while (window > 0 && reference.intervals[window] == UINT64_MAX)
+        window--;
+    return reference.intervals[window] == UINT64_MAX ? 0 : reference.intervals[window];
+}
+
+std::vector<BamIndex::Chunk> BamIndex::Chunks(int32_t ref_id, int64_t begin, int64_t end) const
+{
+    std::vector<Chunk> chunks;
+    if (ref_id < 0 || static_cast<size_t>(ref_id) >= references_.size())
+        return chunks;
+
+    begin = std::max<int64_t>(begin, 0);
+    end = std::min(end, MaxPosition_());
+    if (begin >= end)
+        return chunks;
+
+    const Reference& reference = references_[ref_id];
+
+    // No record overlapping the region starts before the first one
+    // overlapping its first window. CSI has that for every bin, so it's
+    // taken from the smallest one there is around 'begin'.
+    uint64_t min_offset = LinearOffset_(reference, begin);
+    if (csi_ && reference.intervals.empty()) {
+        uint32_t bin = RegionToBin(begin, begin + 1, min_shift_, depth_);
+        while (true) {
+            auto found = reference.bins.find(bin);
+            if (found != reference.bins.end()) {
+                min_offset = found->second.loffset;
+                break;
+            }
+            if (bin == 0)
+                break;
+            bin = (bin - 1) >> 3;
+        }
+    }
+
+    for (uint32_t bin : RegionToBins(begin, end, min_shift_, depth_)) {
+        auto found = reference.bins.find(bin);
+        if (found == reference.bins.end())
+            continue;
+        for (const Chunk& chunk : found->second.chunks) {
+            if (chunk.end > min_offset)
+                chunks.push_back(chunk);
+        }
+    }
+
+    std::sort(chunks.begin(), chunks.end(), [](const Chunk& a, const Chunk& b) {
+        return a.begin < b.begin;
+    });
+
+    // Overlapping and adjacent chunks are read in one go
+    std::vector<Chunk> merged;
+    for (const Chunk& chunk : chunks) {
+        if (!merged.empty() && chunk.begin <= merged.back().end)
+            merged.back().end = std::max(merged.back().end, chunk.end);
+        else
+            merged.push_back(chunk);
+    }
+    return merged;
+}
+
+void BamIndex::AddRecord(int32_t ref_id, int64_t begin, int64_t end, bool mapped,
+                         uint64_t address, uint64_t end_address)
+{
+    if (ref_id < 0 || static_cast<size_t>(ref_id) >= references_.size()) {
+        unplaced_++;
+        return;
+    }
+
+    Reference& reference = references_[ref_id];
+    begin = std::clamp<int64_t>(begin, 0, MaxPosition_() - 1);
+    end = std::clamp<int64_t>(end, begin + 1, MaxPosition_());
+
+    // Consecutive records of a bin make up a single chunk
+    auto& chunks = reference.bins[RegionToBin(begin, end, min_shift_, depth_)].chunks;
+    if (!chunks.empty() && chunks.back().end == address)
+        chunks.back().end = end_address;
+    else
+        chunks.push_back({address, end_address});
+
+    const size_t last_window = static_cast<size_t>((end - 1) >> min_shift_);
+    if (reference.intervals.size() <= last_window)
+        reference.intervals.resize(last_window + 1, UINT64_MAX);
+    for (size_t window = begin >> min_shift_; window <= last_window; ++window)
+        reference.intervals[window] = std::min(reference.intervals[window], address);
+
+    reference.begin_address = std::min(reference.begin_address, address);
+    reference.end_address = end_address;
+    if (mapped)
+        reference.mapped++;
+    else
+        reference.unmapped++;
+}
+
+void BamIndex::TranslateOffsets(const std::function<uint64_t(uint64_t)>& translate)
+{
+    for (auto& reference : references_) {
+        for (auto& bin : reference.bins) {
+            for (Chunk& chunk : bin.second.chunks) {
+                chunk.begin = translate(chunk.begin);
+                chunk.end = translate(chunk.end);
+            }
+        }
+        // UINT64_MAX marks windows and references without records
+        for (uint64_t& offset : reference.intervals) {
+            if (offset != UINT64_MAX)
+                offset = translate(offset);
+        }
+        if (reference.begin_address != UINT64_MAX) {
+            reference.begin_address = translate(reference.begin_address);
+            reference.end_address = translate(reference.end_address);
+        }
+    }
+}
+
+std::string BamIndex::PathForFile(const std::string& bam_path) const
+{
+    return bam_path + (csi_ ? ".csi" : ".bai");
+}
+
+bool BamIndex::Save(const std::string& bam_path) const
+{
+    IndexWriter writer;
+    writer.WriteBytes(csi_ ? kCsiMagic : kBaiMagic, sizeof(kBaiMagic));
+    if (csi_) {
+        writer.WriteInt32(min_shift_);
+        writer.WriteInt32(depth_);
+        writer.WriteInt32(0);  // l_aux
+    }
+    writer.WriteInt32(static_cast<int32_t>(references_.size()));
+
+    for (const auto& reference : references_) {
+        const bool has_records = reference.mapped + reference.unmapped > 0;
+        writer.WriteInt32(static_cast<int32_t>(reference.bins.size() + (has_records ? 1 : 0)));
+
+        std::vector<uint32_t> numbers;
+        for (const auto& bin : reference.bins)
+            numbers.push_back(bin.first);
+        std::sort(numbers.begin(), numbers.end());
+
+        for (uint32_t number : numbers) {
+            const Bin& bin = reference.bins.at(number);
+            writer.WriteUint32(number);
+            if (csi_) {
+                // The linear index entry of the first window of the bin
+                int level = 0;
+                while (level < depth_ && number >= FirstBinOfLevel(level + 1))
+                    level++;
+                const int64_t bin_begin = static_cast<int64_t>(number - FirstBinOfLevel(level))
+                                          << (min_shift_ + (depth_ - level) * 3);
+                writer.WriteUint64(LinearOffset_(reference, bin_begin));
+            }
+            writer.WriteInt32(static_cast<int32_t>(bin.chunks.size()));
+            for (const Chunk& chunk : bin.chunks) {
+                writer.WriteUint64(chunk.begin);
+                writer.WriteUint64(chunk.end);
+            }
+        }
+
+        // Pseudo-bin with where the reference's records are and how many
+        // of them are mapped, as samtools idxstats expects
+        if (has_records) {
+            writer.WriteUint32(MetadataBin_());
+            if (csi_)
+                writer.WriteUint64(0);
+            writer.WriteInt32(2);
+            writer.WriteUint64(reference.begin_address);
+            writer.WriteUint64(reference.end_address);
+            writer.WriteUint64(reference.mapped);
+            writer.WriteUint64(reference.unmapped);
+        }
+
+        if (!csi_) {
+            writer.WriteInt32(static_cast<int32_t>(reference.intervals.size()));
+            uint64_t previous = 0;
+            for (uint64_t offset : reference.intervals) {
+                if (offset != UINT64_MAX)
+                    previous = offset;
+                writer.WriteUint64(previous);
+            }
+        }
+    }
+    writer.WriteUint64(unplaced_);
+
+    const std::string path = PathForFile(bam_path);
+    if (csi_) {
+        try {
+            BgzfStringOutputStream output(path, 1);
+            output.Write(writer.data());
+            output.Close();
+        } catch (const prim::UserVisibleError&) {
+            remove(path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    bool written = fwrite(writer.data().data(), 1, writer.data().size(), file) == writer.data().size();
+    if (fclose(file) != 0)
+        written = false;
+    if (!written)
+        remove(path.c_str());
+    return written;
+}
+
+bool BamIndex::csi() const noexcept
+{
+    return csi_;
+}
+
+size_t BamIndex::size() const noexcept
+{
+    return references_.size();
+}
+
+}  // namespace gene
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_FILE_ALIGNMENT_BAM_BAMINDEX_HPP_
+#define LIBGENE_FILE_ALIGNMENT_BAM_BAMINDEX_HPP_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+namespace gene {
+
+//
+// BAI or CSI index of a coordinate-sorted BAM file. Every reference is
+// split into a hierarchy of bins, each listing the chunks of the file (as
+// BGZF virtual offsets) holding the records which fall into it. BAI has 6
+// levels of bins, the smallest covering 16 kbp, plus a linear index of the
+// first record overlapping every 16 kbp window. CSI can have more levels for
+// references longer than 2^29 and keeps the linear index per bin instead.
+//
+class BamIndex {
+ public:
+    // [begin, end) in BGZF virtual offsets
+    struct Chunk {
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    // Binning scheme of BAI: 2^14 bp bins, 5 levels above them
+    static constexpr int kBaiMinShift = 14;
+    static constexpr int kBaiDepth = 5;
+
+    // <file>.bai, <file without .bam>.bai as samtools also makes them, and
+    // <file>.csi
+    static std::vector<std::string> PathsForFile(const std::string& bam_path);
+
+    // Returns nullptr if there's no index for the file or it's damaged
+    static std::unique_ptr<BamIndex> Load(const std::string& bam_path);
+    static std::unique_ptr<BamIndex> LoadFile(const std::string& index_path);
+
+    // An empty index to be built with AddRecord(). It's a BAI unless
+    // 'max_length', the length of the longest reference, needs more levels.
+    BamIndex(int32_t n_ref, int64_t max_length);
+
+    // The smallest bin holding all of [begin, end), and all bins which may
+    // hold records overlapping it. Positions are 0-based.
+    static uint32_t RegionToBin(int64_t begin, int64_t end,
+                                int min_shift = kBaiMinShift, int depth = kBaiDepth) noexcept;
+    static std::vector<uint32_t> RegionToBins(int64_t begin, int64_t end,
+                                              int min_shift = kBaiMinShift, int depth = kBaiDepth);
+
+    // Sorted, non-overlapping chunks holding every record of reference
+    // 'ref_id' which may overlap [begin, end)
+    std::vector<Chunk> Chunks(int32_t ref_id, int64_t begin, int64_t end) const;
+
+    // Records have to be added in file order. 'begin' and 'end' is the
+    // reference span of a placed record, 'address' and 'end_address' the
+    // virtual offsets of its first byte and of the byte after it. Records
+    // without a reference (ref_id -1) are only counted.
+    void AddRecord(int32_t ref_id, int64_t begin, int64_t end, bool mapped,
+                   uint64_t address, uint64_t end_address);
+    // Replaces every offset added so far with 'translate(offset)', which has
+    // to keep them in order. Lets records be added with offsets into the
+    // uncompressed data while writing, before their blocks are compressed.
+    void TranslateOffsets(const std::function<uint64_t(uint64_t)>& translate);
+
+    // Saves as <bam_path>.bai or <bam_path>.csi, depending on the format
+    std::string PathForFile(const std::string& bam_path) const;
+    bool Save(const std::string& bam_path) const;
+
+    bool csi() const noexcept;
+    // Number of references
+    size_t size() const noexcept;
+
+ private:
+    struct Bin {
+        // CSI only: smallest virtual offset of a record overlapping the bin
+        uint64_t loffset{0};
+        std::vector<Chunk> chunks;
+    };
+
+    struct Reference {
+        std::unordered_map<uint32_t, Bin> bins;
+        // Smallest virtual offset of a record overlapping every window of
+        // 2^min_shift bp. Only saved in BAI.
+        std::vector<uint64_t> intervals;
+
+        // Kept in the metadata pseudo-bin
+        uint64_t begin_address{UINT64_MAX};
+        uint64_t end_address{0};
+        uint64_t mapped{0};
+        uint64_t unmapped{0};
+    };
+
+    BamIndex() = default;
+    static std::unique_ptr<BamIndex> Parse_(const std::vector<uint8_t>& data);
+    uint32_t MetadataBin_() const noexcept;
+    int64_t MaxPosition_() const noexcept;
+    // Smallest virtual offset of a record overlapping 'position', as far
+    // as the linear index knows
+    uint64_t LinearOffset_(const Reference& reference, int64_t position) const;
+
+    bool csi_{false};
+    int min_shift_{kBaiMinShift};
+    int depth_{kBaiDepth};
+    std::vector<Reference> references_;
+    // Records without a reference
+    uint64_t unplaced_{0};
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_FILE_ALIGNMENT_BAM_BAMINDEX_HPP_
@@ -0,0 +1,81 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include "BamRecordView.hpp"
+#include "BamSequence.hpp"
+
+namespace gene {
+
+std::string_view BamRecordView::read_name() const noexcept
+{
+    const char* name = reinterpret_cast<const char*>(data_ + 36);
+    return std::string_view(name, l_read_name() > 0 ? l_read_name() - 1 : 0);
+}
+
+int64_t BamRecordView::reference_end() const noexcept
+{
+    return Cigar::ReferenceEnd(pos(), Cigar::ReferenceLength(cigar_data_(), n_cigar_op()));
+}
+
+char BamRecordView::base(int32_t i) const noexcept
+{
+    const uint8_t bases = sequence_data_()[i / 2];
+    return bmtls::kBases[i % 2 ? bases & 0xF : bases >> 4];
+}
+
+const uint8_t* BamRecordView::aux_data() const noexcept
+{
+    return quality_data_() + l_seq();
+}
+
+int32_t BamRecordView::aux_size() const noexcept
+{
+    return static_cast<int32_t>(data_ + size() - aux_data());
+}
+
+void BamRecordView::DecodeCigar(std::string& out) const
+{
+    out.clear();
+    Cigar::AppendTo(cigar_data_(), n_cigar_op(), out);
+}
+
+void BamRecordView::DecodeSequence(std::string& out) const
+{
+    const int32_t length = l_seq();
+    if (length == 0) {
+        out.assign(1, '*');
+        return;
+    }
+
+    out.resize(length);
+    bmtls::decodeBases(sequence_data_(), length, out.data());
+}
+
+void BamRecordView::DecodeQuality(std::string& out) const
+{
+    const int32_t length = l_seq();
+    const uint8_t* qualities = quality_data_();
+    if (length == 0 || qualities[0] == 0xFF) {
+        out.assign(1, '*');
+        return;
+    }
+
+    out.resize(length);
+    bmtls::decodeQualities(qualities, length, out.data());
+}
+
+}  // namespace gene
@@ -0,0 +1,129 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBGENE_FILE_ALIGNMENT_BAM_BAMRECORDVIEW_HPP_
+#define LIBGENE_FILE_ALIGNMENT_BAM_BAMRECORDVIEW_HPP_
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+#include "BamUtils.hpp"
+#include "../sam/Cigar.hpp"
+#include "../sam/SamTag.hpp"
+
+namespace gene {
+
+//
+// Read-only view of a BAM record in the memory it was inflated into. Nothing
+// is decoded up front: the fixed fields are read on access and the variable
+// ones only when asked for, so code which looks at a few fields of every
+// record doesn't pay for the rest. A view is only valid as long as the
+// memory it points to, which for BamFile is until its next read.
+//
+class BamRecordView {
+ public:
+    BamRecordView() = default;
+    // 'data' points to the record's block_size; nullptr makes an empty view
+    explicit BamRecordView(const uint8_t* data) noexcept : data_(data) {}
+
+    explicit operator bool() const noexcept { return data_ != nullptr; }
+
+    // The record including its block_size
+    const uint8_t* data() const noexcept { return data_; }
+    int32_t size() const noexcept { return 4 + bmtls::getUint32(data_); }
+
+    // -1 for unplaced reads
+    int32_t ref_id() const noexcept { return bmtls::getUint32(data_ + 4); }
+    // 0-based, i.e. POS - 1
+    int32_t pos() const noexcept { return bmtls::getUint32(data_ + 8); }
+    uint8_t l_read_name() const noexcept { return data_[12]; }
+    uint8_t mapq() const noexcept { return data_[13]; }
+    uint16_t bin() const noexcept { return bmtls::getUint16(data_ + 14); }
+    uint16_t n_cigar_op() const noexcept { return bmtls::getUint16(data_ + 16); }
+    uint16_t flag() const noexcept { return bmtls::getUint16(data_ + 18); }
+    int32_t l_seq() const noexcept { return bmtls::getUint32(data_ + 20); }
+    int32_t next_ref_id() const noexcept { return bmtls::getUint32(data_ + 24); }
+    int32_t next_pos() const noexcept { return bmtls::getUint32(data_ + 28); }
+    int32_t tlen() const noexcept { return bmtls::getUint32(data_ + 32); }
+
+    // Without the terminating NUL
+    std::string_view read_name() const noexcept;
+
+    // Length << 4 | operation, with operations ‘MIDNSHP=X’→‘012345678’
+    uint32_t cigar_op(int i) const noexcept { return bmtls::getUint32(cigar_data_() + i * 4); }
+    // 0-based position just past the last reference base the record is
+    // aligned to; records without any are treated as covering one base
+    int64_t reference_end() const noexcept;
+
+    // Base 'i' out of ‘=ACMGRSVTWYHKDBN’
+    char base(int32_t i) const noexcept;
+    // Phred quality of base 'i', 0xFF if the record has none
+    uint8_t quality(int32_t i) const noexcept { return quality_data_()[i]; }
+
+    // Auxiliary data, up to the end of the record
+    const uint8_t* aux_data() const noexcept;
+    int32_t aux_size() const noexcept;
+    // Typed lookups in it, e.g. tags().GetString("RG"), without a copy
+    SamTagView tags() const noexcept { return SamTagView(aux_data(), aux_size()); }
+
+    // SAM text of the variable fields, written into 'out' so its memory can
+    // be reused from record to record. Missing ones come out as "*". The
+    // quality string is offset by 33, as in SAM and FASTQ.
+    void DecodeCigar(std::string& out) const;
+    void DecodeSequence(std::string& out) const;
+    void DecodeQuality(std::string& out) const;
+    // The CIGAR packed, as SamRecord keeps it
+    void DecodeCigar(Cigar& out) const { out.Assign(cigar_data_(), n_cigar_op()); }
+
+ private:
+    const uint8_t* cigar_data_() const noexcept { return data_ + 36 + l_read_name(); }
+    const uint8_t* sequence_data_() const noexcept { return cigar_data_() + n_cigar_op() * 4; }
+    const uint8_t* quality_data_() const noexcept { return sequence_data_() + (l_seq() + 1) / 2; }
+
+    const uint8_t* data_{nullptr};
+};
+
+//
+// Predicate on the fixed fields of a BAM record, so records can be dropped
+// with a few loads before anything variable-length is decoded. The default
+// one accepts every record.
+//
+struct BamRecordFilter {
+    // FLAG bits which all have to be set, and ones none of which may be
+    uint16_t required_flags{0};
+    uint16_t excluded_flags{0};
+    uint8_t min_mapq{0};
+    // Inclusive range of refIDs; -1 is that of unplaced reads
+    int32_t min_ref_id{-1};
+    int32_t max_ref_id{INT32_MAX};
+
+    bool Accepts(const BamRecordView& record) const noexcept {
+        const uint16_t flag = record.flag();
+        const int32_t ref_id = record.ref_id();
+        return (flag & required_flags) == required_flags && !(flag & excluded_flags) &&
+               record.mapq() >= min_mapq && ref_id >= min_ref_id && ref_id <= max_ref_id;
+    }
+    bool AcceptsAll() const noexcept {
+        return required_flags == 0 && excluded_flags == 0 && min_mapq == 0 &&
+               min_ref_id <= -1 && max_ref_id == INT32_MAX;
+    }
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_FILE_ALIGNMENT_BAM_BAMRECORDVIEW_HPP_
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LIBGENE_BAM_SEQUENCE_SIMD
+#include <immintrin.h>
+#endif
+
+#include "BamSequence.hpp"
+
+namespace gene::bmtls {
+
+static void DecodeBasesScalar(const uint8_t* packed, int32_t length, char* out) noexcept
+{
+    for (int32_t i = 0; i < length / 2; ++i) {
+        out[i * 2] = kBases[packed[i] >> 4];
+        out[i * 2 + 1] = kBases[packed[i] & 0xF];
+    }
+    if (length % 2)
+        out[length - 1] = kBases[packed[length / 2] >> 4];
+}
+
+static void DecodeQualitiesScalar(const uint8_t* qualities, int32_t length, char* out) noexcept
+{
+    for (int32_t i = 0; i < length; ++i)
+        out[i] = static_cast<char>(qualities[i] + 33);
+}
+
+#ifdef LIBGENE_BAM_SEQUENCE_SIMD
+
+// Both decoders return the number of input bytes they handled, a multiple of
+// their vector width
+
+__attribute__((target("avx2")))
+static int32_t DecodeBasesAvx2(const uint8_t* packed, int32_t bytes, char* out) noexcept
+{
+    const __m256i table = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(kBases)));
+    const __m256i low_nybbles = _mm256_set1_epi8(0x0F);
+
+    int32_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(packed + i));
+        const __m256i first = _mm256_shuffle_epi8(
+            table, _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nybbles));
+        const __m256i second = _mm256_shuffle_epi8(table, _mm256_and_si256(v, low_nybbles));
+
+        // Interleaving works within 128-bit lanes: bytes 0-7 and 16-23 go into
+        // 'low', 8-15 and 24-31 into 'high'
+        const __m256i low = _mm256_unpacklo_epi8(first, second);
+        const __m256i high = _mm256_unpackhi_epi8(first, second);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 2),
+                            _mm256_permute2x128_si256(low, high, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i * 2 + 32),
+                            _mm256_permute2x128_si256(low, high, 0x31));
+    }
+    return i;
+}
+
+__attribute__((target("ssse3")))
+static int32_t DecodeBasesSsse3(const uint8_t* packed, int32_t bytes, char* out) noexcept
+{
+    const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i *>(kBases));
+    const __m128i low_nybbles = _mm_set1_epi8(0x0F);
+
+    int32_t i = 0;
+    for (; i + 16 <= bytes; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(packed + i));
+        const __m128i first = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), low_nybbles));
+        const __m128i second = _mm_shuffle_epi8(table, _mm_and_si128(v, low_nybbles));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2), _mm_unpacklo_epi8(first, second));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i * 2 + 16), _mm_unpackhi_epi8(first, second));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static int32_t DecodeQualitiesAvx2(const uint8_t* qualities, int32_t length, char* out) noexcept
+{
+    const __m256i offset = _mm256_set1_epi8(33);
+    int32_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(qualities + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), _mm256_add_epi8(v, offset));
+    }
+    return i;
+}
+
+// SSE2 is part of x86-64, so this one needs no check
+static int32_t DecodeQualitiesSse2(const uint8_t* qualities, int32_t length, char* out) noexcept
+{
+    const __m128i offset = _mm_set1_epi8(33);
+    int32_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(qualities + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_add_epi8(v, offset));
+    }
+    return i;
+}
+
+static bool HasAvx2()
+{
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+
+static bool HasSsse3()
+{
+    static const bool has = __builtin_cpu_supports("ssse3");
+    return has;
+}
+
+void decodeBases(const uint8_t* packed, int32_t length, char* out) noexcept
+{
+    // Only whole bytes, each holding two bases, are vectorized
+    int32_t done = 0;
+    if (HasAvx2())
+        done = DecodeBasesAvx2(packed, length / 2, out);
+    if (HasSsse3())
+        done += DecodeBasesSsse3(packed + done, length / 2 - done, out + done * 2);
+    DecodeBasesScalar(packed + done, length - done * 2, out + done * 2);
+}
+
+void decodeQualities(const uint8_t* qualities, int32_t length, char* out) noexcept
+{
+    int32_t done = 0;
+    if (HasAvx2())
+        done = DecodeQualitiesAvx2(qualities, length, out);
+    done += DecodeQualitiesSse2(qualities + done, length - done, out + done);
+    DecodeQualitiesScalar(qualities + done, length - done, out + done);
+}
+
+#else
+
+void decodeBases(const uint8_t* packed, int32_t length, char* out) noexcept
+{
+    DecodeBasesScalar(packed, length, out);
+}
+
+void decodeQualities(const uint8_t* qualities, int32_t length, char* out) noexcept
+{
+    DecodeQualitiesScalar(qualities, length, out);
+}
+
+#endif
+
+}  // namespace gene::bmtls
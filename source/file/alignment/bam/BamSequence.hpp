@@ -0,0 +1,38 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBGENE_FILE_ALIGNMENT_BAM_BAMSEQUENCE_HPP_
+#define LIBGENE_FILE_ALIGNMENT_BAM_BAMSEQUENCE_HPP_
+
+#include <cstdint>
+
+namespace gene::bmtls {
+
+// Bases by their 4-bit code in BAM's SEQ
+inline constexpr char kBases[] = "=ACMGRSVTWYHKDBN";
+
+// Expands 'length' bases packed two per byte, the first one in the high
+// nybble, into ‘=ACMGRSVTWYHKDBN’ letters. On x86-64 it looks 16 or 32 bytes
+// of nybbles up at a time with PSHUFB (AVX2 or SSSE3, whichever the CPU has).
+void decodeBases(const uint8_t* packed, int32_t length, char* out) noexcept;
+
+// Phred qualities to SAM/FASTQ characters, i.e. + 33
+void decodeQualities(const uint8_t* qualities, int32_t length, char* out) noexcept;
+
+}  // namespace gene::bmtls
+
+#endif  // LIBGENE_FILE_ALIGNMENT_BAM_BAMSEQUENCE_HPP_
@@ -49,6 +49,23 @@ static inline uint64_t getUint64(const uint8_t arr[]) {
     uint64_t(uint8_t(arr[7])) << 56;
 }
 
+static inline void putUint16(uint8_t arr[], uint16_t value) {
+    arr[0] = uint8_t(value);
+    arr[1] = uint8_t(value >> 8);
+}
+
+static inline void putUint32(uint8_t arr[], uint32_t value) {
+    arr[0] = uint8_t(value);
+    arr[1] = uint8_t(value >> 8);
+    arr[2] = uint8_t(value >> 16);
+    arr[3] = uint8_t(value >> 24);
+}
+
+static inline void putUint64(uint8_t arr[], uint64_t value) {
+    putUint32(arr, uint32_t(value));
+    putUint32(arr + 4, uint32_t(value >> 32));
+}
+
 }  // namespace gene::bmtls
 
 #endif  // LIBGENE_FILE_ALIGNMENT_BAM_BAMUTILS_HPP_
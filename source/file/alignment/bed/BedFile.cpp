@@ -55,9 +55,9 @@ void BedFile::write(const SamRecord& record)
 {
     out_file_->Write(record.chrom);
     out_file_->Write('\t');
-    out_file_->Write(std::to_string(record.chromStart));
+    out_file_->WriteInt(record.chromStart);
     out_file_->Write('\t');
-    out_file_->Write(std::to_string(record.chromEnd));
+    out_file_->WriteInt(record.chromEnd);
     out_file_->Write('\t');
     out_file_->Write(record.name);
     out_file_->WriteLine();
@@ -92,19 +92,19 @@ void FinderFile::Write(FinderRecord& record)
 
         out_file_->Write(separator_);
         // Start of the left query
-        out_file_->WriteQuoted(std::to_string(record.start - record.left_match_length));
+        out_file_->WriteQuotedInt(record.start - record.left_match_length);
     }
 
     out_file_->Write(separator_);
-    out_file_->WriteQuoted(std::to_string(record.start));
+    out_file_->WriteQuotedInt(record.start);
 
     out_file_->Write(separator_);
-    out_file_->WriteQuoted(std::to_string(record.end));
+    out_file_->WriteQuotedInt(record.end);
 
     if (paired_queries_search_mode_ || paired_queries_search_mode_ || coupled_queries_search_mode_) {
         out_file_->Write(separator_);
         // End of the right query
-        out_file_->WriteQuoted(std::to_string(record.end + record.right_match_length));
+        out_file_->WriteQuotedInt(record.end + record.right_match_length);
 
         out_file_->Write(separator_);
         out_file_->WriteQuoted(record.left_query_id);
@@ -123,7 +123,7 @@ void FinderFile::Write(FinderRecord& record)
 
         out_file_->Write(separator_);
         // Length of the internal sequence
-        out_file_->WriteQuoted(std::to_string(record.internal_seq.size()));
+        out_file_->WriteQuotedInt(record.internal_seq.size());
     } else {
         out_file_->Write(separator_);
         out_file_->WriteQuoted(record.query_id);
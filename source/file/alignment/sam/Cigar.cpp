@@ -0,0 +1,195 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+#include "Cigar.hpp"
+#include "../bam/BamUtils.hpp"
+#include "../../../utils/MiscPrimitives.hpp"
+
+namespace gene {
+
+static const char kCigarOps[] = "MIDNSHP=X";
+
+// Bit 'op' is set for the operations which consume the reference, the
+// query, or the query while aligning it
+constexpr uint32_t kReferenceOps = 1 << Cigar::kMatch | 1 << Cigar::kDeletion |
+                                   1 << Cigar::kSkip | 1 << Cigar::kSequenceMatch |
+                                   1 << Cigar::kSequenceMismatch;
+constexpr uint32_t kAlignedQueryOps = 1 << Cigar::kMatch | 1 << Cigar::kInsertion |
+                                      1 << Cigar::kSequenceMatch |
+                                      1 << Cigar::kSequenceMismatch;
+constexpr uint32_t kQueryOps = kAlignedQueryOps | 1 << Cigar::kSoftClip;
+
+// Operation lengths have 28 bits
+constexpr uint32_t kMaxOpLength = (1u << 28) - 1;
+
+// The same for operations held as uint32_t and as bytes of a BAM record,
+// with 'op(i)' returning operation 'i'
+
+// Sum of the lengths of the operations whose bit is set in 'mask'
+template <typename GetOp>
+static int64_t SumLengths(uint32_t mask, int32_t count, GetOp op) noexcept
+{
+    int64_t length = 0;
+    for (int32_t i = 0; i < count; ++i) {
+        if (mask >> Cigar::OpOf(op(i)) & 1)
+            length += Cigar::LengthOf(op(i));
+    }
+    return length;
+}
+
+template <typename GetOp>
+static void AppendText(int32_t count, GetOp op, std::string& out)
+{
+    if (count == 0) {
+        out += '*';
+        return;
+    }
+
+    // Up to 9 digits of length and the operation
+    const size_t start = out.size();
+    out.resize(start + count * 10);
+    char* next = out.data() + start;
+    for (int32_t i = 0; i < count; ++i) {
+        const uint32_t code = Cigar::OpOf(op(i));
+        next = std::to_chars(next, next + 9, Cigar::LengthOf(op(i))).ptr;
+        *next++ = code < 9 ? kCigarOps[code] : '?';
+    }
+    out.resize(next - out.data());
+}
+
+void Cigar::Assign(std::string_view text)
+{
+    size_ = 0;
+    if (text.empty() || text == "*")
+        return;
+
+    auto malformed = [text]() {
+        return prim::UserVisibleError("Malformed CIGAR '" + std::string(text) + "'");
+    };
+    const char* next = text.data();
+    const char* end = next + text.size();
+    while (next != end) {
+        uint32_t length;
+        auto parsed = std::from_chars(next, end, length);
+        if (parsed.ec != std::errc() || parsed.ptr == end || length > kMaxOpLength)
+            throw malformed();
+        const char* op = *parsed.ptr ? std::strchr(kCigarOps, *parsed.ptr) : nullptr;
+        if (!op)
+            throw malformed();
+        Append(static_cast<Op>(op - kCigarOps), length);
+        next = parsed.ptr + 1;
+    }
+}
+
+uint32_t* Cigar::Resize_(int32_t size)
+{
+    if (size > kInlineOps) {
+        if (size_ <= kInlineOps)
+            ops_.assign(inline_ops_.begin(), inline_ops_.begin() + size_);
+        ops_.resize(size);
+    } else if (size_ > kInlineOps) {
+        std::copy(ops_.begin(), ops_.begin() + size, inline_ops_.begin());
+    }
+    size_ = size;
+    return size_ > kInlineOps ? ops_.data() : inline_ops_.data();
+}
+
+void Cigar::Assign(const uint8_t* data, int32_t count)
+{
+    size_ = 0;
+    uint32_t* ops = Resize_(count);
+    for (int32_t i = 0; i < count; ++i)
+        ops[i] = bmtls::getUint32(data + i * 4);
+}
+
+void Cigar::Append(Op op, uint32_t length)
+{
+    uint32_t* ops = Resize_(size_ + 1);
+    ops[size_ - 1] = length << 4 | op;
+}
+
+std::string Cigar::ToString() const
+{
+    std::string text;
+    AppendTo(text);
+    return text;
+}
+
+void Cigar::AppendTo(std::string& out) const
+{
+    const uint32_t* ops = data();
+    AppendText(size_, [ops](int32_t i) { return ops[i]; }, out);
+}
+
+void Cigar::AppendTo(const uint8_t* data, int32_t count, std::string& out)
+{
+    AppendText(count, [data](int32_t i) { return bmtls::getUint32(data + i * 4); }, out);
+}
+
+int64_t Cigar::ReferenceLength() const noexcept
+{
+    const uint32_t* ops = data();
+    return SumLengths(kReferenceOps, size_, [ops](int32_t i) { return ops[i]; });
+}
+
+int64_t Cigar::ReferenceLength(const uint8_t* data, int32_t count) noexcept
+{
+    return SumLengths(kReferenceOps, count,
+                      [data](int32_t i) { return bmtls::getUint32(data + i * 4); });
+}
+
+int64_t Cigar::QueryAlignedLength() const noexcept
+{
+    const uint32_t* ops = data();
+    return SumLengths(kAlignedQueryOps, size_, [ops](int32_t i) { return ops[i]; });
+}
+
+int64_t Cigar::QueryLength() const noexcept
+{
+    const uint32_t* ops = data();
+    return SumLengths(kQueryOps, size_, [ops](int32_t i) { return ops[i]; });
+}
+
+int64_t Cigar::SoftClipLeft() const noexcept
+{
+    const uint32_t* op = data();
+    int32_t i = 0;
+    if (i < size_ && OpOf(op[i]) == kHardClip)
+        ++i;
+    return i < size_ && OpOf(op[i]) == kSoftClip ? LengthOf(op[i]) : 0;
+}
+
+int64_t Cigar::SoftClipRight() const noexcept
+{
+    const uint32_t* op = data();
+    int32_t i = size_ - 1;
+    if (i >= 0 && OpOf(op[i]) == kHardClip)
+        --i;
+    return i >= 0 && OpOf(op[i]) == kSoftClip ? LengthOf(op[i]) : 0;
+}
+
+bool Cigar::operator==(const Cigar& other) const noexcept
+{
+    return size_ == other.size_ &&
+           std::equal(data(), data() + size_, other.data());
+}
+
+}  // namespace gene
@@ -0,0 +1,112 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBGENE_FILE_ALIGNMENT_SAM_CIGAR_HPP_
+#define LIBGENE_FILE_ALIGNMENT_SAM_CIGAR_HPP_
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+namespace gene {
+
+//
+// CIGAR in BAM's packed form, one uint32_t per operation: its length << 4
+// | its code, with ‘MIDNSHP=X’→‘012345678’. It's only turned into text for
+// output, so spans and clips are worked out without parsing anything. The
+// few operations most alignments have are kept without an allocation.
+//
+class Cigar {
+ public:
+    enum Op : uint8_t {
+        kMatch = 0,
+        kInsertion = 1,
+        kDeletion = 2,
+        kSkip = 3,
+        kSoftClip = 4,
+        kHardClip = 5,
+        kPadding = 6,
+        kSequenceMatch = 7,
+        kSequenceMismatch = 8
+    };
+
+    Cigar() = default;
+    // Parses SAM text, where "*" (or nothing) is an empty CIGAR. Throws
+    // prim::UserVisibleError if it's malformed.
+    explicit Cigar(std::string_view text) { Assign(text); }
+
+    // Same, reusing the memory the operations are in
+    void Assign(std::string_view text);
+    // 'count' operations as stored in a BAM record
+    void Assign(const uint8_t* data, int32_t count);
+    void Append(Op op, uint32_t length);
+    void Clear() noexcept { size_ = 0; }
+
+    int32_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    const uint32_t* data() const noexcept {
+        return size_ > kInlineOps ? ops_.data() : inline_ops_.data();
+    }
+    uint32_t operator[](int32_t i) const noexcept { return data()[i]; }
+
+    static Op OpOf(uint32_t op) noexcept { return static_cast<Op>(op & 0xF); }
+    static uint32_t LengthOf(uint32_t op) noexcept { return op >> 4; }
+
+    // SAM text, "*" if empty
+    std::string ToString() const;
+    void AppendTo(std::string& out) const;
+    // Same for 'count' operations as stored in a BAM record
+    static void AppendTo(const uint8_t* data, int32_t count, std::string& out);
+
+    // Reference bases the alignment covers (M, D, N, = and X)
+    int64_t ReferenceLength() const noexcept;
+    static int64_t ReferenceLength(const uint8_t* data, int32_t count) noexcept;
+    // 0-based position just past the last of them, for an alignment
+    // starting at 0-based 'pos'. Alignments without any are treated as
+    // covering one base, as for binning.
+    int64_t ReferenceEnd(int64_t pos) const noexcept { return ReferenceEnd(pos, ReferenceLength()); }
+    static int64_t ReferenceEnd(int64_t pos, int64_t reference_length) noexcept {
+        return pos + (reference_length > 0 ? reference_length : 1);
+    }
+    // Query bases aligned to the reference or inserted (M, I, = and X)
+    int64_t QueryAlignedLength() const noexcept;
+    // Those and the soft-clipped ones, i.e. the length SEQ must have
+    int64_t QueryLength() const noexcept;
+    // Soft-clipped bases at either end, inside any hard clip
+    int64_t SoftClipLeft() const noexcept;
+    int64_t SoftClipRight() const noexcept;
+
+    bool operator==(const Cigar& other) const noexcept;
+    bool operator!=(const Cigar& other) const noexcept { return !(*this == other); }
+
+ private:
+    static constexpr int32_t kInlineOps = 6;
+
+    // Makes room for 'size' operations, keeping the ones there are
+    uint32_t* Resize_(int32_t size);
+
+    std::array<uint32_t, kInlineOps> inline_ops_{};
+    // Only used for more than kInlineOps
+    std::vector<uint32_t> ops_;
+    int32_t size_{0};
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_FILE_ALIGNMENT_SAM_CIGAR_HPP_
@@ -21,7 +21,9 @@
 
 #include "SamFile.hpp"
 #include "SamRecord.hpp"
+#include "SamRecordView.hpp"
 #include "SamHeader.hpp"
+#include "../../../utils/MiscPrimitives.hpp"
 
 using std::string;
 
@@ -63,9 +65,9 @@ void SamFile::write(const SamRecord& record)
 {
     out_file_->Write(record.chrom);
     out_file_->Write('\t');
-    out_file_->Write(std::to_string(record.chromStart));
+    out_file_->WriteInt(record.chromStart);
     out_file_->Write('\t');
-    out_file_->Write(std::to_string(record.chromEnd));
+    out_file_->WriteInt(record.chromEnd);
     out_file_->Write('\t');
     out_file_->Write(record.name);
     out_file_->WriteLine();
@@ -73,7 +75,17 @@ void SamFile::write(const SamRecord& record)
 
 SamRecord SamFile::read()
 {
-    return SamRecord(in_file_->ReadLine());
+    return SamRecord(in_file_->ReadLineView());
+}
+
+bool SamFile::NextView(SamRecordView& record)
+{
+    const std::string_view line = in_file_->ReadLineView();
+    if (line.empty())
+        return false;
+    if (!record.Parse(line))
+        throw prim::UserVisibleError("Malformed SAM record '" + string(line) + "'");
+    return true;
 }
 
 int64_t SamFile::length() const
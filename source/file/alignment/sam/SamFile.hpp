@@ -29,6 +29,7 @@
 namespace gene {
 
 class SamRecord;
+class SamRecordView;
 
 class SamFile : public AlignmentFile {
  private:
@@ -44,6 +45,10 @@ class SamFile : public AlignmentFile {
     bool isValidAlignmentFile() const override;
 
     SamRecord read() override;
+    // Same as read() without copying anything: parses the next line into
+    // 'record', which is valid until the next read. Returns false at the
+    // end of the file. Throws prim::UserVisibleError for a malformed line.
+    bool NextView(SamRecordView& record);
     void write(const SamRecord& record) override;
 
     static std::string defaultExtension();
@@ -44,10 +44,91 @@ SamHeader::SamHeader(const std::vector<std::string>& headerLines) {
         else if (tag == "PG")
             pg.push_back(std::make_unique<SamHeaderPG>(line));
         else if (tag == "CO")
-            comment += line.substr(3);
+            comments.push_back(line.substr(line.size() > 3 && line[3] == '\t' ? 4 : 3));
         else
             PrintfLog("ERROR: Unknown tag: @%s\n", tag.c_str());
     }
 }
 
+std::string SamHeader::text() const {
+    std::string text;
+    auto field = [&text](const char* tag, const std::string& value) {
+        if (!value.empty()) {
+            text += '\t';
+            text += tag;
+            text += ':';
+            text += value;
+        }
+    };
+
+    // Parsed lines are written out as they were read
+    auto original = [&text](const SamHeaderComponent& component) {
+        if (component.original_line.empty())
+            return false;
+        text += component.original_line;
+        text += '\n';
+        return true;
+    };
+
+    for (const auto& line : hd) {
+        if (original(*line))
+            continue;
+        text += "@HD";
+        field("VN", line->VN);
+        field("SO", line->SO);
+        field("GO", line->GO);
+        text += '\n';
+    }
+    for (const auto& line : sq) {
+        if (original(*line))
+            continue;
+        text += "@SQ";
+        field("SN", line->SN);
+        if (line->LN > 0)
+            field("LN", std::to_string(line->LN));
+        field("AS", line->AS);
+        field("M5", line->M5);
+        field("SP", line->SP);
+        field("UR", line->UR);
+        text += '\n';
+    }
+    for (const auto& line : rg) {
+        if (original(*line))
+            continue;
+        text += "@RG";
+        field("ID", line->ID);
+        field("CN", line->CN);
+        field("DS", line->DS);
+        field("DT", line->DT);
+        field("FO", line->FO);
+        field("KS", line->KS);
+        field("LB", line->LB);
+        field("PG", line->PG);
+        field("PI", line->PI);
+        field("PL", line->PL);
+        field("PM", line->PM);
+        field("PU", line->PU);
+        field("SM", line->SM);
+        text += '\n';
+    }
+    for (const auto& line : pg) {
+        if (original(*line))
+            continue;
+        text += "@PG";
+        field("ID", line->ID);
+        field("PN", line->PN);
+        field("CL", line->CL);
+        field("PP", line->PP);
+        field("DS", line->DS);
+        field("VN", line->VN);
+        text += '\n';
+    }
+    for (const auto& comment : comments) {
+        text += "@CO\t";
+        text += comment;
+        text += '\n';
+    }
+    return text;
+}
+
 }  // namespace gene
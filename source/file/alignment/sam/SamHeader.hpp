@@ -34,11 +34,17 @@ class SamHeader {
     explicit SamHeader(const std::vector<std::string>& headerLines);
     virtual ~SamHeader() = default;
 
+    // Header lines in SAM format, each ending with a newline: @HD first,
+    // then @SQ, @RG, @PG and @CO. Parsed lines are written as they were
+    // read; only those built in code are made up from their fields.
+    std::string text() const;
+
     std::vector<std::unique_ptr<SamHeaderHD>> hd;
     std::vector<std::unique_ptr<SamHeaderSQ>> sq;
     std::vector<std::unique_ptr<SamHeaderRG>> rg;
     std::vector<std::unique_ptr<SamHeaderPG>> pg;
-    std::string comment;
+    // One per @CO line, without the "@CO\t"
+    std::vector<std::string> comments;
 };
 
 }  // namespace gene
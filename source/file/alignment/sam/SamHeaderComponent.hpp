@@ -18,19 +18,33 @@
 #define LIBGENE_FILE_ALIGNMENT_SAM_SAMHEADERCOMPONENT_HPP_
 
 #include <string>
+#include <cstdint>
 #include <cassert>
 
 namespace gene {
 
 class SamHeaderComponent {
  public:
+    SamHeaderComponent() = default;
+    explicit SamHeaderComponent(const std::string& line) : original_line(line) {}
     virtual ~SamHeaderComponent() = default;
 
+    // The line this was parsed from, which SamHeader::text() writes back
+    // unchanged, tags without a field here included. Clear it to have the
+    // line written from the fields instead.
+    std::string original_line;
+
  protected:
+    // Position of the 'tag' field ("TG:value") in 'line', or npos
+    static int64_t FindTag_(const std::string& line, const char *tag) {
+        const size_t position = line.find('\t' + std::string(tag) + ':');
+        return position == std::string::npos ? std::string::npos : position + 1;
+    }
     std::string ExtractNextTagValue_(const std::string& line,
                                      int64_t *tag_position) {
         assert(tag_position != nullptr);
-        int64_t next_space_position = line.find(' ', *tag_position);
+        // Fields are separated by tabs; values may contain spaces
+        int64_t next_space_position = line.find('\t', *tag_position);
         *tag_position += 3;
         if (next_space_position == std::string::npos)
             return line.substr(*tag_position);
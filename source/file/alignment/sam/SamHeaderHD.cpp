@@ -21,15 +21,16 @@
 namespace gene {
 
 SamHeaderHD::SamHeaderHD(const std::string& line)
+: SamHeaderComponent(line)
 {
     int64_t tag_position = std::string::npos;
-    if ((tag_position = line.find("VN")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "VN")) != std::string::npos) {
         VN = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("SO")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "SO")) != std::string::npos) {
         SO = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("GO")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "GO")) != std::string::npos) {
         GO = ExtractNextTagValue_(line, &tag_position);
     }
 }
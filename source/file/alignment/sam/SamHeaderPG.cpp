@@ -21,27 +21,25 @@
 namespace gene {
 
 SamHeaderPG::SamHeaderPG(const std::string& line)
+: SamHeaderComponent(line)
 {
-    // Program version.
-    std::string VN;
-
     int64_t tag_position = std::string::npos;
-    if ((tag_position = line.find("ID")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "ID")) != std::string::npos) {
         ID = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("PN")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "PN")) != std::string::npos) {
         PN = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("CL")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "CL")) != std::string::npos) {
         CL = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("PP")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "PP")) != std::string::npos) {
         PP = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("DS")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "DS")) != std::string::npos) {
         DS = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("VN")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "VN")) != std::string::npos) {
         VN = ExtractNextTagValue_(line, &tag_position);
     }
 }
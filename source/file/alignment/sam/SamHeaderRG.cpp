@@ -21,45 +21,46 @@
 namespace gene {
 
 SamHeaderRG::SamHeaderRG(const std::string& line)
+: SamHeaderComponent(line)
 {
     int64_t tag_position = std::string::npos;
-    if ((tag_position = line.find("ID")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "ID")) != std::string::npos) {
         ID = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("CN")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "CN")) != std::string::npos) {
         CN = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("DS")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "DS")) != std::string::npos) {
         DS = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("DT")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "DT")) != std::string::npos) {
         DT = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("FO")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "FO")) != std::string::npos) {
         FO = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("KS")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "KS")) != std::string::npos) {
         KS = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("LB")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "LB")) != std::string::npos) {
         LB = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("PG")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "PG")) != std::string::npos) {
         PG = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("PI")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "PI")) != std::string::npos) {
         PI = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("PL")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "PL")) != std::string::npos) {
         PL = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("PM")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "PM")) != std::string::npos) {
         PM = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("PU")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "PU")) != std::string::npos) {
         PU = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("SM")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "SM")) != std::string::npos) {
         SM = ExtractNextTagValue_(line, &tag_position);
     }
 }
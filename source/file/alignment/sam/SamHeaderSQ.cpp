@@ -20,27 +20,28 @@
 
 namespace gene {
 
-SamHeaderSQ::SamHeaderSQ(const std::string& line) : LN(255)
+SamHeaderSQ::SamHeaderSQ(const std::string& line)
+: SamHeaderComponent(line)
 {
     int64_t tag_position = std::string::npos;
-    if ((tag_position = line.find("SN")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "SN")) != std::string::npos) {
         SN = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("AS")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "AS")) != std::string::npos) {
         AS = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("M5")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "M5")) != std::string::npos) {
         M5 = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("SP")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "SP")) != std::string::npos) {
         SP = ExtractNextTagValue_(line, &tag_position);
     }
-    if ((tag_position = line.find("UR")) != std::string::npos) {
+    if ((tag_position = FindTag_(line, "UR")) != std::string::npos) {
         UR = ExtractNextTagValue_(line, &tag_position);
     }
 
-    // uint8_t field
-    if ((tag_position = line.find("LN")) != std::string::npos) {
+    // int32_t field
+    if ((tag_position = FindTag_(line, "LN")) != std::string::npos) {
         std::string value;
         value = ExtractNextTagValue_(line, &tag_position);
         LN = std::stoi(value);
@@ -60,8 +61,8 @@ std::string SamHeaderSQ::report() const
         str += "\tSP: " + SP + '\n';
     if (!UR.empty())
         str += "\tUR: " + UR + '\n';
-    if (LN != 255)
-        str += "\tLN: " + std::to_string(static_cast<int>(LN)) + '\n';
+    if (LN != 0)
+        str += "\tLN: " + std::to_string(LN) + '\n';
     return str;
 }
 
@@ -39,8 +39,9 @@ class SamHeaderSQ : public SamHeaderComponent {
     // fields. Regular expression: [!-)+-<>-~][!-~]*
     std::string SN;
 
-    // MANDATORY FIELD. Reference sequence length. Range: [1,231-1]
-    uint8_t LN;
+    // MANDATORY FIELD. Reference sequence length. Range: [1,2^31-1], 0 if
+    // not set
+    int32_t LN{0};
 
     // Genome assembly identifier.
     std::string AS;
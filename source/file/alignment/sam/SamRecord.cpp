@@ -17,43 +17,40 @@
 #include <string>
 
 #include "SamRecord.hpp"
+#include "../../../utils/MiscPrimitives.hpp"
 
 
 using std::string;
 
 namespace gene {
 
-SamRecord::SamRecord(const string& line)
+SamRecord::SamRecord(std::string_view line)
 {
-    auto nextToken = [](int64_t& previousTabPosition, const string& line) {
-        int64_t tabPosition = line.find('\t', previousTabPosition + 1);
-        int64_t temp = previousTabPosition;
-        previousTabPosition = tabPosition;
-        if (temp == 0)
-            temp = -1;
-        return line.substr(temp + 1, tabPosition - temp - 1);
-    };
-
-    int64_t tabPosition = 0;
-
-    QNAME = nextToken(tabPosition, line);
-    if (tabPosition == string::npos)
+    SamRecordView view;
+    if (view.Parse(line)) {
+        Assign(view);
         return;
+    }
+    if (line.find('\t') != std::string_view::npos)
+        throw prim::UserVisibleError("Malformed SAM record '" + string(line) + "'");
+    QNAME = line;
+}
 
-    auto token = nextToken(tabPosition, line);
-    FLAG = std::stoi(token);
-    RNAME = nextToken(tabPosition, line);
-    POS = std::stoi(nextToken(tabPosition, line));
-    token = nextToken(tabPosition, line);
-    MAPQ = std::stoi(token);
-    CIGAR = nextToken(tabPosition, line);
-    RNEXT = nextToken(tabPosition, line);
-    token = nextToken(tabPosition, line);
-    PNEXT = std::stoi(token);
-    token = nextToken(tabPosition, line);
-    TLEN = std::stoi(token);
-    SEQ = nextToken(tabPosition, line);
-    QUAL = nextToken(tabPosition, line);
+void SamRecord::Assign(const SamRecordView& view)
+{
+    QNAME = view.qname();
+    FLAG = view.flag();
+    RNAME = view.rname();
+    POS = view.pos();
+    MAPQ = view.mapq();
+    CIGAR.Assign(view.cigar());
+    RNEXT = view.rnext();
+    PNEXT = view.pnext();
+    TLEN = view.tlen();
+    SEQ = view.seq();
+    QUAL = view.qual();
+    if (!view.CopyTags(tag))
+        throw prim::UserVisibleError("Malformed optional field in read '" + QNAME + "'");
 }
 
 }  // namespace gene
@@ -18,9 +18,12 @@
 #define LIBGENE_FILE_ALIGNMENT_SAM_SAMRECORD_HPP_
 
 #include <string>
+#include <string_view>
 #include <cstdint>
 
 #include "../AlignmentRecord.hpp"
+#include "Cigar.hpp"
+#include "SamRecordView.hpp"
 #include "SamTag.hpp"
 
 namespace gene {
@@ -28,23 +31,36 @@ namespace gene {
 class SamRecord : public AlignmentRecord {
  public:
     SamRecord() = default;
-    explicit SamRecord(const std::string& line);
+    // Parses a line of SAM text, optional fields included. Throws
+    // prim::UserVisibleError if it's malformed. A line without any tab
+    // only sets QNAME.
+    explicit SamRecord(std::string_view line);
+    explicit SamRecord(const SamRecordView& view) { Assign(view); }
     virtual ~SamRecord() = default;
 
     std::string QNAME;
-    uint32_t FLAG;
+    uint32_t FLAG{0};
     std::string RNAME;
-    int32_t POS;
-    int32_t MAPQ;
-    std::string CIGAR;
+    int32_t POS{0};
+    int32_t MAPQ{0};
+    Cigar CIGAR;
     std::string RNEXT;
-    int32_t PNEXT;
-    int32_t TLEN;
+    int32_t PNEXT{0};
+    int32_t TLEN{0};
     std::string SEQ;
     std::string QUAL;
 
     SamTag tag;
 
+    // Copies the fields of 'view' into the ones of the record, reusing
+    // their memory. Throws prim::UserVisibleError if an optional field is
+    // malformed.
+    void Assign(const SamRecordView& view);
+
+    // 0-based position just past the last reference base the record is
+    // aligned to; records without any are treated as covering one base
+    int64_t ReferenceEnd() const noexcept { return CIGAR.ReferenceEnd(POS - 1); }
+
     // BED-related fields
     std::string chrom;
     int64_t chromStart;
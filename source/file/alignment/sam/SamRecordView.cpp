@@ -0,0 +1,245 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "SamRecordView.hpp"
+#include "SamTag.hpp"
+#include "../bam/BamUtils.hpp"
+
+namespace gene {
+
+// Number making up all of 'text'
+template <typename T>
+static bool ParseNumber(std::string_view text, T& value) noexcept
+{
+    const char* end = text.data() + text.size();
+    auto parsed = std::from_chars(text.data(), end, value);
+    return parsed.ec == std::errc() && parsed.ptr == end;
+}
+
+// Not every standard library has std::from_chars() for floating point
+static bool ParseFloat(std::string_view text, float& value) noexcept
+{
+    char buffer[64];
+    if (text.empty() || text.size() >= sizeof(buffer))
+        return false;
+    std::memcpy(buffer, text.data(), text.size());
+    buffer[text.size()] = '\0';
+    char* end;
+    value = std::strtof(buffer, &end);
+    return end == buffer + text.size();
+}
+
+// Splits off the text up to the next 'separator', or the rest of it
+static std::string_view NextToken(std::string_view& text, char separator) noexcept
+{
+    const void* found = text.empty() ? nullptr : std::memchr(text.data(), separator, text.size());
+    const size_t length = found ? static_cast<const char*>(found) - text.data() : text.size();
+    std::string_view token = text.substr(0, length);
+    text.remove_prefix(found ? length + 1 : length);
+    return token;
+}
+
+bool SamRecordView::Parse(std::string_view line) noexcept
+{
+    // QUAL is the only mandatory field which may end the line
+    std::string_view fields[11];
+    const char* next = line.data();
+    const char* const end = next + line.size();
+    for (int i = 0; i < 11; ++i) {
+        const char* tab = next == end ? nullptr
+                                      : static_cast<const char*>(std::memchr(next, '\t', end - next));
+        if (!tab && i < 10)
+            return false;
+        if (!tab)
+            tab = end;
+        fields[i] = std::string_view(next, tab - next);
+        next = tab == end ? end : tab + 1;
+    }
+
+    qname_ = fields[0];
+    rname_ = fields[2];
+    cigar_ = fields[5];
+    rnext_ = fields[6];
+    seq_ = fields[9];
+    qual_ = fields[10];
+    tags_ = std::string_view(next, end - next);
+    return ParseNumber(fields[1], flag_) &&
+           ParseNumber(fields[3], pos_) &&
+           ParseNumber(fields[4], mapq_) &&
+           ParseNumber(fields[7], pnext_) &&
+           ParseNumber(fields[8], tlen_);
+}
+
+std::optional<std::string_view> SamRecordView::Find_(std::string_view tag,
+                                                     char& type) const noexcept
+{
+    std::string_view fields = tags_;
+    while (!fields.empty()) {
+        const std::string_view field = NextToken(fields, '\t');
+        if (field.size() >= 5 && field[2] == ':' && field[4] == ':' &&
+            field.compare(0, 2, tag) == 0) {
+            type = field[3];
+            return field.substr(5);
+        }
+    }
+    return std::nullopt;
+}
+
+char SamRecordView::Type(std::string_view tag) const noexcept
+{
+    char type = 0;
+    Find_(tag, type);
+    return type;
+}
+
+std::optional<int64_t> SamRecordView::GetInt(std::string_view tag) const noexcept
+{
+    char type;
+    auto value = Find_(tag, type);
+    int64_t number;
+    if (!value || type != 'i' || !ParseNumber(*value, number))
+        return std::nullopt;
+    return number;
+}
+
+std::optional<float> SamRecordView::GetFloat(std::string_view tag) const noexcept
+{
+    char type;
+    auto value = Find_(tag, type);
+    float number;
+    if (!value || type != 'f' || !ParseFloat(*value, number))
+        return std::nullopt;
+    return number;
+}
+
+std::optional<char> SamRecordView::GetChar(std::string_view tag) const noexcept
+{
+    char type;
+    auto value = Find_(tag, type);
+    if (!value || type != 'A' || value->size() != 1)
+        return std::nullopt;
+    return value->front();
+}
+
+std::optional<std::string_view> SamRecordView::GetString(std::string_view tag) const noexcept
+{
+    char type;
+    auto value = Find_(tag, type);
+    if (!value || (type != 'Z' && type != 'H'))
+        return std::nullopt;
+    return value;
+}
+
+// Appends element 'text' of a 'B' array of 'type' in BAM layout
+static bool AppendArrayElement(std::string_view text, char type, std::vector<uint8_t>& out)
+{
+    uint8_t bytes[4];
+    int32_t size = 4;
+    if (type == 'f') {
+        float value;
+        if (!ParseFloat(text, value))
+            return false;
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        bmtls::putUint32(bytes, bits);
+    } else {
+        int64_t value;
+        if (!ParseNumber(text, value))
+            return false;
+        int64_t min = INT32_MIN, max = INT32_MAX;
+        switch (type) {
+            case 'c': min = INT8_MIN; max = INT8_MAX; size = 1; break;
+            case 'C': min = 0; max = UINT8_MAX; size = 1; break;
+            case 's': min = INT16_MIN; max = INT16_MAX; size = 2; break;
+            case 'S': min = 0; max = UINT16_MAX; size = 2; break;
+            case 'i': break;
+            case 'I': min = 0; max = UINT32_MAX; break;
+            default: return false;
+        }
+        if (value < min || value > max)
+            return false;
+        bmtls::putUint32(bytes, static_cast<uint32_t>(value));
+    }
+    out.insert(out.end(), bytes, bytes + size);
+    return true;
+}
+
+bool SamRecordView::CopyTags(SamTag& out) const
+{
+    out.Clear();
+    std::string_view fields = tags_;
+    std::vector<uint8_t> elements;
+    while (!fields.empty()) {
+        const std::string_view field = NextToken(fields, '\t');
+        if (field.size() < 5 || field[2] != ':' || field[4] != ':')
+            return false;
+        const std::string_view tag = field.substr(0, 2);
+        std::string_view value = field.substr(5);
+        switch (field[3]) {
+            case 'A':
+                if (value.size() != 1)
+                    return false;
+                out.AppendChar(tag, value.front());
+                break;
+            case 'i': {
+                int64_t number;
+                if (!ParseNumber(value, number) || number < INT32_MIN || number > UINT32_MAX)
+                    return false;
+                out.AppendInt(tag, number);
+                break;
+            }
+            case 'f': {
+                float number;
+                if (!ParseFloat(value, number))
+                    return false;
+                out.AppendFloat(tag, number);
+                break;
+            }
+            case 'Z':
+                out.AppendString(tag, value);
+                break;
+            case 'H':
+                out.AppendHex(tag, value);
+                break;
+            case 'B': {
+                const std::string_view type = NextToken(value, ',');
+                if (type.size() != 1 || !type.front() || !std::strchr("cCsSiIf", type.front()))
+                    return false;
+                elements.clear();
+                uint32_t count = 0;
+                while (!value.empty()) {
+                    if (!AppendArrayElement(NextToken(value, ','), type.front(), elements))
+                        return false;
+                    ++count;
+                }
+                out.AppendArray(tag, type.front(), count, elements.data());
+                break;
+            }
+            default:
+                return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace gene
@@ -0,0 +1,98 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef LIBGENE_FILE_ALIGNMENT_SAM_SAMRECORDVIEW_HPP_
+#define LIBGENE_FILE_ALIGNMENT_SAM_SAMRECORDVIEW_HPP_
+
+#include <string_view>
+#include <optional>
+#include <cstdint>
+
+namespace gene {
+
+class SamTag;
+
+//
+// Fields of a line of SAM text, as views into the line: nothing is copied,
+// and the numbers are converted with std::from_chars. Optional fields are
+// only looked at when asked for. One view is meant to be reused from line
+// to line (see SamFile::NextView()), so going through a file doesn't
+// allocate at all. It's only valid as long as the line.
+//
+class SamRecordView {
+ public:
+    SamRecordView() = default;
+
+    // Splits 'line' at its tabs and converts the numeric fields. Returns
+    // false if it has fewer than the 11 mandatory fields or a number is
+    // malformed, after which the fields are unspecified.
+    bool Parse(std::string_view line) noexcept;
+
+    std::string_view qname() const noexcept { return qname_; }
+    uint32_t flag() const noexcept { return flag_; }
+    std::string_view rname() const noexcept { return rname_; }
+    // 1-based, as in the text
+    int32_t pos() const noexcept { return pos_; }
+    int32_t mapq() const noexcept { return mapq_; }
+    std::string_view cigar() const noexcept { return cigar_; }
+    std::string_view rnext() const noexcept { return rnext_; }
+    int32_t pnext() const noexcept { return pnext_; }
+    int32_t tlen() const noexcept { return tlen_; }
+    std::string_view seq() const noexcept { return seq_; }
+    std::string_view qual() const noexcept { return qual_; }
+
+    // The optional fields, TG:TYPE:VALUE separated by tabs
+    std::string_view tags() const noexcept { return tags_; }
+
+    // Type of field 'tag' out of AifZHB, 0 if there's no such field
+    char Type(std::string_view tag) const noexcept;
+    bool Has(std::string_view tag) const noexcept { return Type(tag) != 0; }
+
+    // As for SamTagView: each getter returns nothing if there's no such
+    // field, it has a different type or its value is malformed. GetInt()
+    // takes i, GetFloat() f, GetChar() A and GetString() Z or H.
+    std::optional<int64_t> GetInt(std::string_view tag) const noexcept;
+    std::optional<float> GetFloat(std::string_view tag) const noexcept;
+    std::optional<char> GetChar(std::string_view tag) const noexcept;
+    std::optional<std::string_view> GetString(std::string_view tag) const noexcept;
+
+    // Replaces the fields of 'out' with the optional fields in BAM layout,
+    // arrays included, in their order and with any repeated tag kept.
+    // Returns false if one of them is malformed.
+    bool CopyTags(SamTag& out) const;
+
+ private:
+    // Value of field 'tag', with its type in 'type', or nothing
+    std::optional<std::string_view> Find_(std::string_view tag, char& type) const noexcept;
+
+    std::string_view qname_;
+    std::string_view rname_;
+    std::string_view cigar_;
+    std::string_view rnext_;
+    std::string_view seq_;
+    std::string_view qual_;
+    std::string_view tags_;
+    uint32_t flag_{0};
+    int32_t pos_{0};
+    int32_t mapq_{0};
+    int32_t pnext_{0};
+    int32_t tlen_{0};
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_FILE_ALIGNMENT_SAM_SAMRECORDVIEW_HPP_
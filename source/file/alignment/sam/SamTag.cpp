@@ -14,73 +14,303 @@
  * limitations under the License.
  */
 
-#include <iostream>
+
+#include <cassert>
+#include <cstring>
 
 #include "SamTag.hpp"
 #include "../bam/BamUtils.hpp"
 
 namespace gene {
 
-int SamTag::readTag(const uint8_t* start, int32_t tag_length)
+// Size of an array element or of a fixed-size value, 0 for other types
+static int32_t FixedSize(uint8_t type) noexcept
+{
+    switch (type) {
+        case 'A':
+        case 'c':
+        case 'C':
+            return 1;
+        case 's':
+        case 'S':
+            return 2;
+        case 'i':
+        case 'I':
+        case 'f':
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+// Size of the value following the type code at 'type', or -1 if it's of an
+// unknown type or runs past 'end'
+static int32_t ValueSize(const uint8_t* type, const uint8_t* end) noexcept
 {
-    // int read_bytes_so_far = 0;
-    // char tag[2];
-    if (tag_length > 0) {
-    //    std::memcpy(tag, start, 2);
-    //    std::cout << "\nTAG: " << tag << ':' <<
-    //                 (start + 2)[0] << ':' << start+3 << '\n';
+    const uint8_t* value = type + 1;
+    const int64_t available = end - value;
+    int64_t size = FixedSize(*type);
+    if (*type == 'Z' || *type == 'H') {
+        const void* nul = std::memchr(value, 0, available);
+        if (!nul)
+            return -1;
+        size = static_cast<const uint8_t*>(nul) - value + 1;
+    } else if (*type == 'B') {
+        // Element type and count first
+        if (available < 5)
+            return -1;
+        const int32_t element_size = value[0] != 'A' ? FixedSize(value[0]) : 0;
+        if (element_size == 0)
+            return -1;
+        size = 5 + static_cast<int64_t>(bmtls::getUint32(value + 1)) * element_size;
+    } else if (size == 0) {
+        return -1;
     }
-    // if (tag[0] != 'A' &&
-    //    tag[0] != 'B' &&
-    //    tag[0] != 'C' &&
-    //    tag[0] != 'E')
-    {
-        return tag_length;
+    return size <= available ? static_cast<int32_t>(size) : -1;
+}
+
+static int64_t ReadInt(uint8_t type, const uint8_t* value) noexcept
+{
+    switch (type) {
+        case 'c':
+            return static_cast<int8_t>(value[0]);
+        case 'C':
+            return value[0];
+        case 's':
+            return static_cast<int16_t>(bmtls::getUint16(value));
+        case 'S':
+            return bmtls::getUint16(value);
+        case 'i':
+            return static_cast<int32_t>(bmtls::getUint32(value));
+        default:
+            return bmtls::getUint32(value);
+    }
+}
+
+static float ReadFloat(const uint8_t* value) noexcept
+{
+    const uint32_t bits = bmtls::getUint32(value);
+    float f;
+    std::memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+int64_t SamTagView::Array::GetInt(uint32_t i) const noexcept
+{
+    return ReadInt(type, data + i * FixedSize(type));
+}
+
+double SamTagView::Array::GetFloat(uint32_t i) const noexcept
+{
+    if (type == 'f')
+        return ReadFloat(data + i * 4);
+    return static_cast<double>(GetInt(i));
+}
+
+int32_t SamTagView::ValidSize(const uint8_t* data, int32_t size) noexcept
+{
+    const uint8_t* const end = data + size;
+    const uint8_t* field = data;
+    while (end - field >= 3) {
+        const int32_t value_size = ValueSize(field + 2, end);
+        if (value_size < 0)
+            break;
+        field += 3 + value_size;
     }
+    return static_cast<int32_t>(field - data);
+}
+
+const uint8_t* SamTagView::Find_(std::string_view tag) const noexcept
+{
+    assert(tag.size() == 2);
+    const uint8_t* const end = data_ + size_;
+    const uint8_t* field = data_;
+    while (end - field >= 3) {
+        if (field[0] == static_cast<uint8_t>(tag[0]) && field[1] == static_cast<uint8_t>(tag[1]))
+            return field + 2;
+
+        const int32_t value_size = ValueSize(field + 2, end);
+        if (value_size < 0)
+            break;
+        field += 3 + value_size;
+    }
+    return nullptr;
+}
+
+char SamTagView::Type(std::string_view tag) const noexcept
+{
+    const uint8_t* type = Find_(tag);
+    return type ? static_cast<char>(*type) : 0;
+}
+
+std::optional<int64_t> SamTagView::GetInt(std::string_view tag) const noexcept
+{
+    const uint8_t* type = Find_(tag);
+    if (!type || *type == 'A' || *type == 'f' || FixedSize(*type) == 0 ||
+        ValueSize(type, data_ + size_) < 0)
+        return std::nullopt;
+    return ReadInt(*type, type + 1);
+}
+
+std::optional<float> SamTagView::GetFloat(std::string_view tag) const noexcept
+{
+    const uint8_t* type = Find_(tag);
+    if (!type || *type != 'f' || ValueSize(type, data_ + size_) < 0)
+        return std::nullopt;
+    return ReadFloat(type + 1);
+}
+
+std::optional<char> SamTagView::GetChar(std::string_view tag) const noexcept
+{
+    const uint8_t* type = Find_(tag);
+    if (!type || *type != 'A' || ValueSize(type, data_ + size_) < 0)
+        return std::nullopt;
+    return static_cast<char>(type[1]);
+}
+
+std::optional<std::string_view> SamTagView::GetString(std::string_view tag) const noexcept
+{
+    const uint8_t* type = Find_(tag);
+    if (!type || (*type != 'Z' && *type != 'H'))
+        return std::nullopt;
+
+    const int32_t size = ValueSize(type, data_ + size_);
+    if (size < 0)
+        return std::nullopt;
+    // Without the NUL
+    return std::string_view(reinterpret_cast<const char*>(type + 1), size - 1);
+}
+
+std::optional<SamTagView::Array> SamTagView::GetArray(std::string_view tag) const noexcept
+{
+    const uint8_t* type = Find_(tag);
+    if (!type || *type != 'B' || ValueSize(type, data_ + size_) < 0)
+        return std::nullopt;
+    return Array{static_cast<char>(type[1]), bmtls::getUint32(type + 2), type + 6};
+}
 
-//    start += sizeof(tag);
-//    read_bytes_so_far += sizeof(tag);
-//
-//    char val_type = *start;
-//    start += sizeof(val_type);
-//    read_bytes_so_far += sizeof(val_type);
-//
-//    val.A.contents = malloc(tag_length - read_bytes_so_far);
-//    std::memcpy(val.A.contents, start, tag_length - read_bytes_so_far);
-//
-//    switch (val_type)
-//    {
-//        case 'A':
-//        case 'Z':
-//            // String following
-//        case 'B':
-//            val.A.metadata = bmtls::getUint64(start);
-//            start += sizeof(val.A.metadata);
-//            read_bytes_so_far += sizeof(val.A.metadata);
-//            break;
-//        case 'c':
-//        case 'C':
-//            val.C = bmtls::getUint8(start);
-//            start += sizeof(val.c);
-//            read_bytes_so_far += sizeof(val.c);
-//            break;
-//        case 's':
-//        case 'S':
-//            val.S = bmtls::getUint16(start);
-//            start += sizeof(val.S);
-//            read_bytes_so_far += sizeof(val.S);
-//            break;
-//        case 'i':
-//        case 'I':
-//            val.I = bmtls::getUint16(start);
-//            start += sizeof(val.I);
-//            read_bytes_so_far += sizeof(val.I);
-//            break;
-//        default:
-//            // Some unknown tag
-//            break;
-//    }
-//    return read_bytes_so_far;
+int SamTag::readTag(const uint8_t* start, int32_t tag_length)
+{
+    const int32_t size = SamTagView::ValidSize(start, tag_length);
+    data_.assign(reinterpret_cast<const char*>(start), size);
+    return size;
+}
+
+void SamTag::Append_(std::string_view tag, char type)
+{
+    assert(tag.size() == 2);
+    data_ += tag;
+    data_ += type;
+}
+
+void SamTag::SetInt(std::string_view tag, int64_t value)
+{
+    Remove(tag);
+    AppendInt(tag, value);
+}
+
+void SamTag::SetFloat(std::string_view tag, float value)
+{
+    Remove(tag);
+    AppendFloat(tag, value);
+}
+
+void SamTag::SetChar(std::string_view tag, char value)
+{
+    Remove(tag);
+    AppendChar(tag, value);
+}
+
+void SamTag::SetString(std::string_view tag, std::string_view value)
+{
+    Remove(tag);
+    AppendString(tag, value);
+}
+
+void SamTag::SetHex(std::string_view tag, std::string_view value)
+{
+    Remove(tag);
+    AppendHex(tag, value);
+}
+
+void SamTag::SetArray(std::string_view tag, char type, uint32_t count, const uint8_t* elements)
+{
+    Remove(tag);
+    AppendArray(tag, type, count, elements);
+}
+
+void SamTag::AppendInt(std::string_view tag, int64_t value)
+{
+    char type;
+    if (value >= 0)
+        type = value <= UINT8_MAX ? 'C' : value <= UINT16_MAX ? 'S' : 'I';
+    else
+        type = value >= INT8_MIN ? 'c' : value >= INT16_MIN ? 's' : 'i';
+    Append_(tag, type);
+
+    uint8_t bytes[4];
+    bmtls::putUint32(bytes, static_cast<uint32_t>(value));
+    data_.append(reinterpret_cast<const char*>(bytes), FixedSize(type));
+}
+
+void SamTag::AppendFloat(std::string_view tag, float value)
+{
+    Append_(tag, 'f');
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint8_t bytes[4];
+    bmtls::putUint32(bytes, bits);
+    data_.append(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+}
+
+void SamTag::AppendChar(std::string_view tag, char value)
+{
+    Append_(tag, 'A');
+    data_ += value;
+}
+
+void SamTag::AppendString(std::string_view tag, std::string_view value)
+{
+    Append_(tag, 'Z');
+    data_ += value;
+    data_ += '\0';
+}
+
+void SamTag::AppendHex(std::string_view tag, std::string_view value)
+{
+    Append_(tag, 'H');
+    data_ += value;
+    data_ += '\0';
+}
+
+void SamTag::AppendArray(std::string_view tag, char type, uint32_t count, const uint8_t* elements)
+{
+    assert(FixedSize(type) > 0 && type != 'A');
+    Append_(tag, 'B');
+    data_ += type;
+    uint8_t bytes[4];
+    bmtls::putUint32(bytes, count);
+    data_.append(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    data_.append(reinterpret_cast<const char*>(elements),
+                 static_cast<size_t>(count) * FixedSize(type));
+}
+
+bool SamTag::Remove(std::string_view tag)
+{
+    const uint8_t* const start = data();
+    const uint8_t* const end = start + size();
+    const uint8_t* field = start;
+    while (end - field >= 3) {
+        const int32_t value_size = ValueSize(field + 2, end);
+        if (value_size < 0)
+            break;
+        if (field[0] == static_cast<uint8_t>(tag[0]) && field[1] == static_cast<uint8_t>(tag[1])) {
+            data_.erase(field - start, 3 + value_size);
+            return true;
+        }
+        field += 3 + value_size;
+    }
+    return false;
 }
 
 }  // namespace gene
@@ -14,40 +14,126 @@
  * limitations under the License.
  */
 
+
 #ifndef LIBGENE_FILE_ALIGNMENT_SAM_SAMTAG_HPP_
 #define LIBGENE_FILE_ALIGNMENT_SAM_SAMTAG_HPP_
 
 #include <string>
+#include <string_view>
+#include <optional>
 #include <cstdint>
-#include <map>
 
 namespace gene {
 
-class SamTag {
+//
+// Auxiliary fields of an alignment, in BAM's binary layout: a two-character
+// tag, a type code out of AcCsSiIfZHB and the value, one after another.
+// Nothing is parsed up front; every lookup walks the fields, which for the
+// handful a record usually has is cheaper than building a map.
+// SamTagView looks at fields in someone else's memory (a BAM record, see
+// BamRecordView::tags()), SamTag holds its own copy.
+//
+class SamTagView {
+ public:
+    // A 'B' array of 'count' elements of type 'type' (cCsSiIf)
+    struct Array {
+        char type;
+        uint32_t count;
+        const uint8_t* data;
+
+        int64_t GetInt(uint32_t i) const noexcept;
+        // Integer elements are converted
+        double GetFloat(uint32_t i) const noexcept;
+    };
+
+    SamTagView() = default;
+    SamTagView(const uint8_t* data, int32_t size) noexcept : data_(data), size_(size) {}
+
+    // Type code of 'tag', 0 if there's no such field
+    char Type(std::string_view tag) const noexcept;
+    bool Has(std::string_view tag) const noexcept { return Type(tag) != 0; }
+
+    // Each getter returns nothing if there's no such field or it has a
+    // different type: GetInt() takes any of cCsSiI, GetFloat() f, GetChar()
+    // A and GetString() Z or H
+    std::optional<int64_t> GetInt(std::string_view tag) const noexcept;
+    std::optional<float> GetFloat(std::string_view tag) const noexcept;
+    std::optional<char> GetChar(std::string_view tag) const noexcept;
+    std::optional<std::string_view> GetString(std::string_view tag) const noexcept;
+    std::optional<Array> GetArray(std::string_view tag) const noexcept;
+
+    const uint8_t* data() const noexcept { return data_; }
+    int32_t size() const noexcept { return size_; }
+
+    // Length of the well-formed fields at the start of 'data'
+    static int32_t ValidSize(const uint8_t* data, int32_t size) noexcept;
+
  private:
-    union value {
-        int8_t c;    // 'c'
-        uint8_t C;   // 'C'
-        int16_t s;   // 's'
-        uint16_t S;  // 'S'
-        int32_t i;   // 'i'
-        uint32_t I;  // 'I'
-        struct {     // 'A'
-            uint64_t metadata;
-            void* contents;
-        } A;
-    } val;           // Tag value
-
-    char tag[2];        // Two-character tag
-    char val_type;      // Value type: AcCsSiIfZHB
+    // Points to the type code of 'tag', nullptr if it isn't there
+    const uint8_t* Find_(std::string_view tag) const noexcept;
 
+    const uint8_t* data_{nullptr};
+    int32_t size_{0};
+};
+
+class SamTag {
  public:
     SamTag() = default;
+
+    // Takes a copy of the fields of a BAM record. Returns the number of bytes
+    // taken, which is less than 'tag_length' if the fields are damaged.
     int readTag(const uint8_t* start, int32_t tag_length);
 
-    std::map<std::string, int32_t> intTags;
-    std::map<std::string, std::string> stringTags;
-    std::map<std::string, double> doubleTags;
+    SamTagView view() const noexcept {
+        return SamTagView(reinterpret_cast<const uint8_t*>(data_.data()),
+                          static_cast<int32_t>(data_.size()));
+    }
+
+    char Type(std::string_view tag) const noexcept { return view().Type(tag); }
+    bool Has(std::string_view tag) const noexcept { return view().Has(tag); }
+    std::optional<int64_t> GetInt(std::string_view tag) const noexcept { return view().GetInt(tag); }
+    std::optional<float> GetFloat(std::string_view tag) const noexcept { return view().GetFloat(tag); }
+    std::optional<char> GetChar(std::string_view tag) const noexcept { return view().GetChar(tag); }
+    std::optional<std::string_view> GetString(std::string_view tag) const noexcept {
+        return view().GetString(tag);
+    }
+    std::optional<SamTagView::Array> GetArray(std::string_view tag) const noexcept {
+        return view().GetArray(tag);
+    }
+
+    // Setters replace a field with the same tag. Integers take the smallest
+    // type that holds them, like in samtools, and have to fit into
+    // [INT32_MIN, UINT32_MAX]. Strings are stored as Z.
+    void SetInt(std::string_view tag, int64_t value);
+    void SetFloat(std::string_view tag, float value);
+    void SetChar(std::string_view tag, char value);
+    void SetString(std::string_view tag, std::string_view value);
+    void SetHex(std::string_view tag, std::string_view value);
+    // 'count' elements of 'type' (cCsSiIf), laid out as in BAM
+    void SetArray(std::string_view tag, char type, uint32_t count, const uint8_t* elements);
+    bool Remove(std::string_view tag);
+
+    // Same as the setters, but the field goes at the end without looking
+    // for one with the same tag, for filling in all fields of a record
+    void AppendInt(std::string_view tag, int64_t value);
+    void AppendFloat(std::string_view tag, float value);
+    void AppendChar(std::string_view tag, char value);
+    void AppendString(std::string_view tag, std::string_view value);
+    void AppendHex(std::string_view tag, std::string_view value);
+    void AppendArray(std::string_view tag, char type, uint32_t count, const uint8_t* elements);
+
+    // In BAM layout, ready to be written out
+    const uint8_t* data() const noexcept { return reinterpret_cast<const uint8_t*>(data_.data()); }
+    int32_t size() const noexcept { return static_cast<int32_t>(data_.size()); }
+    bool empty() const noexcept { return data_.empty(); }
+    void Clear() noexcept { data_.clear(); }
+
+ private:
+    // Tag and type code of a new field at the end
+    void Append_(std::string_view tag, char type);
+
+    // Short fields (NM:i, say) fit without a heap allocation
+    std::string data_;
 };
 
 }  // namespace gene
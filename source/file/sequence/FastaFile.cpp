@@ -52,10 +52,10 @@ std::string FastaFile::displayExtension()
 
 SequenceRecord FastaFile::Read()
 {
-    std::string line;
+    std::string_view line;
     SequenceRecord result_rec;
 
-    while (!(line = in_file_->ReadLine()).empty()) {
+    while (!(line = in_file_->ReadLineView()).empty()) {
         if (line[0] == '>')
             break;
     }
@@ -63,8 +63,8 @@ SequenceRecord FastaFile::Read()
     if (line.empty())
         return result_rec;
     
-    int64_t space = line.find(' ');
-    if (space == std::string::npos) {
+    auto space = line.find(' ');
+    if (space == std::string_view::npos) {
         // No description
         result_rec.name = line.substr(1);
     } else {
@@ -77,41 +77,53 @@ SequenceRecord FastaFile::Read()
     while ((next_char = in_file_->Peek()) != '>' && next_char != EOF) {
         // Read until the next charater is '>' (Sequence data in single record
         // can span several lines).
-        result_rec.seq += in_file_->ReadLine();
+        result_rec.seq += in_file_->ReadLineView();
     }
     return result_rec;
 }
 
+int64_t FastaFile::FindRecordStart_()
+{
+    while (true) {
+        const int64_t offset = in_file_->uncompressed_position();
+        std::string_view line = in_file_->ReadLineView();
+        if (line.empty())
+            return -1;
+        if (line[0] == '>')
+            return offset;
+    }
+}
+
 std::vector<std::string> FastaFile::ReadVec()
 {
     std::vector<std::string> components;
-    std::string line;
+    std::string_view line;
 
-    while (!(line = in_file_->ReadLine()).empty()) {
+    while (!(line = in_file_->ReadLineView()).empty()) {
         if (line[0] == '>')
             break;
     }
     if (line.empty())
         return components;
 
-    int64_t space = line.find(' ');
+    auto space = line.find(' ');
 
-    if (space == std::string::npos) {
-        components.push_back(line.substr(1));
-        components.push_back("");  // No description
+    if (space == std::string_view::npos) {
+        components.emplace_back(line.substr(1));
+        components.emplace_back("");  // No description
     } else {
-        components.push_back(line.substr(1, space - 1));
-        components.push_back(line.substr(space + 1));
+        components.emplace_back(line.substr(1, space - 1));
+        components.emplace_back(line.substr(space + 1));
     }
-    line.clear();
+    std::string seq;
     int next_char;
 
     while ((next_char = in_file_->Peek()) != '>' && next_char != EOF) {
         // Read until the next charater is '>' (Sequence data in single record
         // can span several lines).
-        line += in_file_->ReadLine();
+        seq += in_file_->ReadLineView();
     }
-    components.push_back(std::move(line));
+    components.push_back(std::move(seq));
     return components;
 }
 
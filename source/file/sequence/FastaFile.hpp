@@ -44,6 +44,8 @@ class FastaFile final : public SequenceFile {
  private:
     bool split_;
 
+    int64_t FindRecordStart_() override;
+
 };
 
 }  // namespace gene
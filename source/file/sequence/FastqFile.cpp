@@ -58,83 +58,90 @@ FastqFile::FastqFile(const std::string& path,
 
 SequenceRecord FastqFile::Read()
 {
-    std::string last_read_line;
+    std::string_view last_read_line;
     SequenceRecord record;
 
-    while (!(last_read_line = in_file_->ReadLine()).empty()) {
-        if (last_read_line[0] != '@')
-            last_read_line.clear();
-        else
+    while (!(last_read_line = in_file_->ReadLineView()).empty()) {
+        if (last_read_line[0] == '@')
             break;
     }
     if (last_read_line.empty())
         return record;
     
-    int64_t space = last_read_line.find(' ');
-    if (space == std::string::npos) {
+    auto space = last_read_line.find(' ');
+    if (space == std::string_view::npos) {
         // No description
         record.name = last_read_line.substr(1);
     } else {
         record.name = last_read_line.substr(1, space - 1);
         record.desc = last_read_line.substr(space + 1);
     }
-    record.seq = in_file_->ReadLine();
+    record.seq = in_file_->ReadLineView();
 
     // Skip until '+' string
-    while (!(last_read_line = in_file_->ReadLine()).empty()) {
-        if (last_read_line[0] != '+')
-            last_read_line.clear();
-        else
+    while (!(last_read_line = in_file_->ReadLineView()).empty()) {
+        if (last_read_line[0] == '+')
             break;
     }
     
-    record.quality = in_file_->ReadLine();
+    record.quality = in_file_->ReadLineView();
     return record;
 }
 
 std::vector<std::string> FastqFile::ReadVec()
 {
-    std::string last_read_line;
+    std::string_view last_read_line;
     std::vector<std::string> components;
 
-    if (last_read_line.empty()) {
-        while (!(last_read_line = in_file_->ReadLine()).empty()) {
-            if (last_read_line[0] != '@')
-                last_read_line.clear();
-            else
-                break;
-        }
+    while (!(last_read_line = in_file_->ReadLineView()).empty()) {
+        if (last_read_line[0] == '@')
+            break;
     }
     if (last_read_line.empty())
         return components;
 
-    int64_t space = last_read_line.find(' ');
+    auto space = last_read_line.find(' ');
 
-    if (space == std::string::npos) {
-        components.push_back(last_read_line.substr(1));
-        components.push_back("");  // No description
+    if (space == std::string_view::npos) {
+        components.emplace_back(last_read_line.substr(1));
+        components.emplace_back("");  // No description
     } else {
-        components.push_back(last_read_line.substr(1, space - 1));
-        components.push_back(last_read_line.substr(space + 1));
+        components.emplace_back(last_read_line.substr(1, space - 1));
+        components.emplace_back(last_read_line.substr(space + 1));
     }
 
-    std::string data = in_file_->ReadLine();
+    std::string data(in_file_->ReadLineView());
 
     // Skip until '+' string
-    while (! (last_read_line = in_file_->ReadLine()).empty()) {
-        if (last_read_line[0] != '+')
-            last_read_line.clear();
-        else
+    while (!(last_read_line = in_file_->ReadLineView()).empty()) {
+        if (last_read_line[0] == '+')
             break;
     }
     components.push_back(std::move(data));
-
-    std::string quality = in_file_->ReadLine();
-    components.push_back(std::move(quality));
+    components.emplace_back(in_file_->ReadLineView());
     return components;
 }
 
 
+int64_t FastqFile::FindRecordStart_()
+{
+    // Quality lines may start with '@' as well, so a header only counts if
+    // the line after its sequence starts with '+'
+    int64_t offsets[3];
+    char first_chars[3];
+    for (int64_t line_number = 0; ; ++line_number) {
+        const int64_t offset = in_file_->uncompressed_position();
+        std::string_view line = in_file_->ReadLineView();
+        if (line.empty())
+            return -1;
+
+        offsets[line_number % 3] = offset;
+        first_chars[line_number % 3] = line[0];
+        if (line_number >= 2 && line[0] == '+' && first_chars[(line_number - 2) % 3] == '@')
+            return offsets[(line_number - 2) % 3];
+    }
+}
+
 void FastqFile::Write(const SequenceRecord& record)
 {
     out_file_->Write('@');
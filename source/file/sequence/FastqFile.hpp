@@ -32,6 +32,8 @@ class FastqFile final : public SequenceFile {
     bool duplicate_;
     bool override_existing_quality_;
 
+    int64_t FindRecordStart_() override;
+
  public:
     FastqFile(const std::string& path,
               const std::unique_ptr<CommandLineFlags>& flags,
@@ -220,7 +220,7 @@ bool GenomicSeparatedFile::isValidGeneFile() const
 
 SequenceRecord GenomicSeparatedFile::Read()
 {
-    std::string str = file_->ReadLine();
+    std::string_view str = file_->ReadLineView();
     SequenceRecord record;
 
     if (str.empty())
@@ -267,7 +267,7 @@ std::vector<std::string> GenomicSeparatedFile::ReadVec()
 {
     std::vector<std::string> components;
 
-    auto line = file_->ReadLine();
+    auto line = file_->ReadLineView();
     const auto& tokenizer = file_->tokenizer();
     tokenizer->SetText(line);
 
@@ -320,6 +320,16 @@ int64_t GenomicSeparatedFile::length() const
     return file_->length();
 }
 
+std::vector<ByteRange> GenomicSeparatedFile::SplitIntoRanges(int count)
+{
+    return file_->SplitIntoRanges(count);
+}
+
+bool GenomicSeparatedFile::RestrictToRange(const ByteRange& range)
+{
+    return file_->RestrictToRange(range);
+}
+
 std::string GenomicSeparatedFile::strFileType() const
 {
     return utils::type2str(file_->fileType());
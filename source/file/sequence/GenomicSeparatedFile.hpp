@@ -58,6 +58,8 @@ class GenomicSeparatedFile : public SequenceFile {
 
     int64_t position() const override;
     int64_t length() const override;
+    std::vector<ByteRange> SplitIntoRanges(int count) override;
+    bool RestrictToRange(const ByteRange& range) override;
     std::string strFileType() const override;
     std::string fileName() const override;
     std::string filePath() const override;
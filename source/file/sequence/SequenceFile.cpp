@@ -24,6 +24,7 @@
 #include "../TxtFile.hpp"
 #include "../../utils/StringUtils.hpp"
 #include "../../utils/CppUtils.hpp"
+#include "../../utils/MiscPrimitives.hpp"
 #include "../../def/Flags.hpp"
 
 namespace gene {
@@ -32,7 +33,7 @@ SequenceFile::SequenceFile(const std::string& path,
                            const std::unique_ptr<CommandLineFlags>& flags,
                            FileType type,
                            OpenMode mode)
-: IOFile(path, type, mode)
+: IOFile(path, type, mode, flags)
 {
     verbose_ = flags->verbose;
     if (mode == OpenMode::Read)
@@ -94,6 +95,16 @@ std::unique_ptr<SequenceFile> SequenceFile::FileWithName(const std::string& name
     }
 }
 
+std::unique_ptr<SequenceFile> SequenceFile::FileWithName(const std::string& name,
+                                                         const std::unique_ptr<CommandLineFlags>& flags,
+                                                         const ByteRange& range)
+{
+    auto file = FileWithName(name, flags, OpenMode::Read);
+    if (file && !file->RestrictToRange(range))
+        throw prim::UserVisibleError("Couldn't seek in input file");
+    return file;
+}
+
 //
 // Sometimes FASTQ (& FASTA) files come in pairs which contain sequences read
 // from different directions of the same sequence. This provides additional
@@ -108,7 +119,7 @@ bool SequenceFile::AttemptToDetermineFileKind_()
     if (extension_start_index == std::string::npos)
         return false;
     
-    if (name.substr(extension_start_index) == ".gz")
+    if (utils::IsCompressedExtension(name.substr(extension_start_index + 1)))
         extension_start_index = static_cast<int>(name.substr(0, extension_start_index - 1).find_last_of('.'));
     
     if (extension_start_index < 3 ||
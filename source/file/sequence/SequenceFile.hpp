@@ -59,6 +59,11 @@ class SequenceFile : public IOFile {
     static SequenceFilePtr FileWithName(const std::string& name,
                                         const std::unique_ptr<CommandLineFlags>& flags,
                                         OpenMode mode);
+    // Opens the file for reading the records in 'range' only, which should
+    // come from SplitIntoRanges()
+    static SequenceFilePtr FileWithName(const std::string& name,
+                                        const std::unique_ptr<CommandLineFlags>& flags,
+                                        const ByteRange& range);
 
     virtual std::string strFileType() const;
     virtual bool isValidGeneFile() const = 0;
@@ -36,7 +36,14 @@ static std::vector<std::string> flagsWithParameters = {
     Flags::kMismatchesEnabled,
     Flags::kMaxAmpliconSize,
     Flags::kMinAmpliconSize,
-    Flags::kSolexaFastqCutoffLength};
+    Flags::kSolexaFastqCutoffLength,
+    Flags::kReadAheadBuffers,
+    Flags::kReadAheadBufferSize,
+    Flags::kDecompressionThreads,
+    Flags::kCompressionThreads,
+    Flags::kAsyncOutput,
+    Flags::kGzipIndexSpan,
+    Flags::kIoBackend};
 
 CommandLineFlags::CommandLineFlags(const char **argv, int argc, int *pStart)
 : CommandLineFlags()
@@ -15,73 +15,179 @@
  */
 
 #include "BgzfBlock.hpp"
-#include <cstdlib>
+#include "../file/alignment/bam/BamUtils.hpp"
+#include "backends/IoBackend.hpp"
+#include "../utils/Crc32.hpp"
+#include <algorithm>
 #include <cstring>
+#include <utility>
 #include <zlib.h>
 
 namespace gene {
 
-constexpr int kBgzfBlockMaxSize = 16 << 20;
+int32_t BgzfBlock::CompressedBlockSize(const uint8_t header[kBgzfBlockHeaderSize]) noexcept
+{
+    // gzip ID1, ID2, CM (deflate) and FLG.FEXTRA
+    if (header[0] != 31 || header[1] != 139 || header[2] != 8 || !(header[3] & 4))
+        return -1;
+
+    // A single 'BC' extra subfield with a 2-byte payload
+    if (bmtls::getUint16(header + 10) != 6 ||
+        header[12] != 66 || header[13] != 67 ||
+        bmtls::getUint16(header + 14) != 2)
+        return -1;
+
+    int32_t block_size = bmtls::getUint16(header + 16) + 1;
+    if (block_size < kBgzfBlockHeaderSize + kBgzfBlockFooterSize)
+        return -1;
+
+    return block_size;
+}
+
+int32_t BgzfBlock::Compress(z_stream& stream,
+                            const uint8_t* data,
+                            int32_t size,
+                            uint8_t* block) noexcept
+{
+    if (deflateReset(&stream) != Z_OK)
+        return -1;
+
+    stream.next_in = const_cast<Bytef *>(data);
+    stream.avail_in = size;
+    stream.next_out = block + kBgzfBlockHeaderSize;
+    stream.avail_out = kBgzfMaxBlockSize - kBgzfBlockHeaderSize - kBgzfBlockFooterSize;
+    if (deflate(&stream, Z_FINISH) != Z_STREAM_END)
+        return -1;
+
+    const int32_t block_size = kBgzfBlockHeaderSize +
+                               static_cast<int32_t>(stream.total_out) +
+                               kBgzfBlockFooterSize;
+
+    // Same header as in the EOF block, except for BSIZE
+    std::memcpy(block, kBgzfEofBlock, kBgzfBlockHeaderSize);
+    bmtls::putUint16(block + 16, block_size - 1);
+
+    uint8_t *footer = block + block_size - kBgzfBlockFooterSize;
+    bmtls::putUint32(footer, static_cast<uint32_t>(crc32(crc32(0, Z_NULL, 0), data, size)));
+    bmtls::putUint32(footer + 4, size);
+    return block_size;
+}
+
+bool BgzfBlock::MatchesFooter(const uint8_t footer[kBgzfBlockFooterSize],
+                              const uint8_t* data,
+                              int32_t size,
+                              bool verify_checksum) noexcept
+{
+    if (bmtls::getUint32(footer + 4) != static_cast<uint32_t>(size))
+        return false;
+
+    return !verify_checksum || bmtls::getUint32(footer) == utils::Crc32(0, data, size);
+}
+
+BgzfBlock::BgzfBlock(BgzfBufferPool& pool)
+: pool_(pool)
+{
+}
 
-BgzfBlock::BgzfBlock(FILE* file,
+bool BgzfBlock::Read(InputBackend& input,
                      int32_t block_size,
                      int32_t carryover_length,
-                     uint8_t* carryover_data)
-: compressed_size_(block_size),
-  carryover_length_(carryover_length)
+                     z_stream& stream,
+                     bool verify_checksum)
 {
-    decompressed_data_ = (uint8_t*)malloc(kBgzfBlockMaxSize);
-    if (carryover_data && carryover_length_ > 0) {
-        std::memcpy(decompressed_data_, carryover_data, carryover_length_);
-    }
-
-    ReadBlock_(file);
-    InflateBlock_();
+    // BSIZE is the total block size minus 1
+    compressed_size_ = block_size + 1 - kBgzfBlockHeaderSize;
+    compressed_data_ = pool_.Acquire(compressed_size_);
+    bool good = input.Read(compressed_data_.data(), compressed_size_) == compressed_size_ &&
+                InflateBlock_(stream, carryover_length, verify_checksum);
+    pool_.Release(std::move(compressed_data_));
+    return good;
 }
 
-bool BgzfBlock::ReadBlock_(FILE* file)
+bool BgzfBlock::in_window() const noexcept
 {
-    compressed_data_ = (uint8_t *)malloc(compressed_size_ - 25);
-    fread(compressed_data_, 1, compressed_size_ - 25, file);
-    return true;
+    const uintptr_t start = reinterpret_cast<uintptr_t>(window_.data());
+    const uintptr_t data = reinterpret_cast<uintptr_t>(data_);
+    return data >= start && data < start + window_.size();
 }
 
-bool BgzfBlock::InflateBlock_()
+uint8_t* BgzfBlock::Extend_(int32_t carryover_length, int32_t size)
 {
-    z_stream stream;
-    stream.avail_in = compressed_size_;
-    stream.avail_out = kBgzfBlockMaxSize;
-    stream.next_in = compressed_data_;
-    stream.next_out = decompressed_data_ + carryover_length_;
-    stream.zalloc = Z_NULL;
-    stream.zfree = Z_NULL;
-    stream.opaque = Z_NULL;
-    if (int err = inflateInit2(&stream, -15); err == Z_OK) {
-        err = inflate(&stream, Z_FINISH);
-        inflateEnd(&stream);
+    const uint8_t* carryover = data_ + size_ - carryover_length;
+    const size_t needed = static_cast<size_t>(carryover_length) + size;
+
+    // Usually the block just goes after the previous one
+    if (in_window() &&
+        static_cast<size_t>(carryover - window_.data()) + needed <= window_.size()) {
+        data_ = carryover;
+        size_ = carryover_length;
+        return window_.data() + (carryover - window_.data()) + carryover_length;
     }
-    decompressed_size_ = static_cast<int32_t>(stream.total_out) + carryover_length_;
-    
-    if (compressed_data_) {
-        free(compressed_data_);
+
+    // Otherwise the carryover moves to the start. The window only has to grow
+    // for records longer than most of it.
+    if (window_.size() < needed) {
+        auto larger = pool_.Acquire(std::max<size_t>({needed, window_.size() * 2, kBgzfWindowSize}));
+        if (carryover_length > 0)
+            std::memcpy(larger.data(), carryover, carryover_length);
+        pool_.Release(std::move(window_));
+        window_ = std::move(larger);
+    } else if (carryover_length > 0) {
+        std::memmove(window_.data(), carryover, carryover_length);
     }
-    return true;
+    data_ = window_.data();
+    size_ = carryover_length;
+    return window_.data() + carryover_length;
+}
+
+bool BgzfBlock::InflateBlock_(z_stream& stream, int32_t carryover_length, bool verify_checksum)
+{
+    uint8_t *out = Extend_(carryover_length, kBgzfMaxBlockSize);
+    if (inflateReset(&stream) != Z_OK)
+        return false;
+
+    stream.next_in = compressed_data_.data();
+    stream.avail_in = compressed_size_ - kBgzfBlockFooterSize;
+    stream.next_out = out;
+    stream.avail_out = kBgzfMaxBlockSize;
+    int err = inflate(&stream, Z_FINISH);
+    const int32_t inflated = static_cast<int32_t>(stream.total_out);
+    size_ += inflated;
+    return err == Z_STREAM_END &&
+           MatchesFooter(compressed_data_.data() + compressed_size_ - kBgzfBlockFooterSize,
+                         out, inflated, verify_checksum);
+}
+
+void BgzfBlock::Assign(const uint8_t* data, int32_t size, int32_t carryover_length)
+{
+    std::memcpy(Extend_(carryover_length, size), data, size);
+    size_ += size;
+}
+
+void BgzfBlock::Detach(int32_t carryover_length)
+{
+    Extend_(carryover_length, 0);
+}
+
+void BgzfBlock::View(const uint8_t* data, int32_t size, int32_t carryover_length) noexcept
+{
+    data_ = data - carryover_length;
+    size_ = carryover_length + size;
 }
 
 const uint8_t* BgzfBlock::data() const noexcept
 {
-    return decompressed_data_;
+    return data_;
 }
 
 int32_t BgzfBlock::size() const noexcept
 {
-    return decompressed_size_;
+    return size_;
 }
 
 BgzfBlock::~BgzfBlock() noexcept
 {
-    if (decompressed_data_)
-        free(decompressed_data_);
+    pool_.Release(std::move(window_));
 }
 
 }  // namespace gene
@@ -18,27 +18,111 @@
 #define BgzfBlock_hpp
 
 #include <cstdint>
-#include <cstdio>
+#include <vector>
+#include <zlib.h>
+
+#include "BgzfBufferPool.hpp"
 
 namespace gene {
 
+class InputBackend;
+
+// BGZF block framing, see section 4.1 of the SAM/BAM format specification
+constexpr int32_t kBgzfBlockHeaderSize = 18;
+constexpr int32_t kBgzfBlockFooterSize = 8;
+constexpr int32_t kBgzfMaxBlockSize = 1 << 16;
+
+// Uncompressed bytes put into one block on output. Leaves room for deflate
+// overhead on incompressible data, the same as bgzip does.
+constexpr int32_t kBgzfMaxBlockInputSize = 0xff00;
+
+// Empty block which marks the end of a BGZF file
+constexpr uint8_t kBgzfEofBlock[] = {
+    31, 139, 8, 4, 0, 0, 0, 0, 0, 255, 6, 0, 66, 67, 2, 0,
+    27, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+// Blocks inflated one after another into a BgzfBlock's window before the
+// bytes still needed have to be moved back to its start
+constexpr int32_t kBgzfWindowSize = 16 * kBgzfMaxBlockSize;
+
+//
+// Inflated contents of the BGZF block read last, preceded by whatever the
+// reader hadn't consumed of the blocks before. A single block is reused for
+// the whole file: buffers are borrowed from a BgzfBufferPool and the
+// z_stream belongs to the caller, so nothing is allocated per block.
+// Blocks are inflated back to back into a window, so the unconsumed end of
+// the previous one is already in front of the next; it's only moved when
+// the window fills up. The contents can also be a view of blocks inflated
+// elsewhere.
+//
 class BgzfBlock {
  private:
-    bool InflateBlock_();
-    bool ReadBlock_(FILE* file);
-    
-    uint8_t* compressed_data_;
-    uint8_t* decompressed_data_;
-    int32_t compressed_size_;
-    int32_t decompressed_size_;
-    int32_t carryover_length_;
+    bool InflateBlock_(z_stream& stream, int32_t carryover_length, bool verify_checksum);
+    // Makes room in the window for 'size' bytes right after the last
+    // 'carryover_length' bytes of the contents, and returns where they go
+    uint8_t* Extend_(int32_t carryover_length, int32_t size);
+
+    BgzfBufferPool& pool_;
+    // Only borrowed while a block is being read
+    std::vector<uint8_t> compressed_data_;
+    std::vector<uint8_t> window_;
+    int32_t compressed_size_{0};
+    // Contents, in the window or elsewhere
+    const uint8_t* data_{nullptr};
+    int32_t size_{0};
 
  public:
-    BgzfBlock(FILE* file,
+    // Returns the total size of the compressed block (BSIZE + 1) which starts
+    // with 'header', or -1 if it isn't a valid BGZF block header.
+    static int32_t CompressedBlockSize(const uint8_t header[kBgzfBlockHeaderSize]) noexcept;
+
+    // Compresses 'size' (at most kBgzfMaxBlockInputSize) bytes into a
+    // complete BGZF block in 'block', which must hold kBgzfMaxBlockSize bytes.
+    // 'stream' has to be set up with deflateInit2() for raw deflate. Returns
+    // the size of the block, or -1 if it couldn't be compressed.
+    static int32_t Compress(z_stream& stream,
+                            const uint8_t* data,
+                            int32_t size,
+                            uint8_t* block) noexcept;
+
+    explicit BgzfBlock(BgzfBufferPool& pool);
+    ~BgzfBlock() noexcept;
+
+    BgzfBlock(const BgzfBlock&) = delete;
+    BgzfBlock& operator=(const BgzfBlock&) = delete;
+
+    // Checks the inflated 'data' of a block against its gzip footer: always
+    // the size, and the CRC32 too with 'verify_checksum'
+    static bool MatchesFooter(const uint8_t footer[kBgzfBlockFooterSize],
+                              const uint8_t* data,
+                              int32_t size,
+                              bool verify_checksum) noexcept;
+
+    // Reads the compressed data and footer of a block whose 18 header bytes
+    // have been read already ('block_size' is BSIZE from the header) and
+    // inflates it with 'stream', which has to be set up with inflateInit2()
+    // for raw deflate. The last 'carryover_length' bytes of the current
+    // contents are kept in front. Returns false on a truncated or damaged
+    // block, or with 'verify_checksum' on a CRC32 mismatch.
+    bool Read(InputBackend& input,
               int32_t block_size,
               int32_t carryover_length,
-              uint8_t* carryover_data);
-    ~BgzfBlock() noexcept;
+              z_stream& stream,
+              bool verify_checksum = false);
+
+    // Same as Read() for a block that has been inflated elsewhere, which is
+    // copied
+    void Assign(const uint8_t* data, int32_t size, int32_t carryover_length);
+    // Same without a copy, for a block inflated elsewhere right after the
+    // carryover, which has to stay where it is as long as it's used
+    void View(const uint8_t* data, int32_t size, int32_t carryover_length) noexcept;
+    // Copies the last 'carryover_length' bytes of viewed contents into the
+    // window, before the memory they're viewed in is released
+    void Detach(int32_t carryover_length);
+    // Whether the contents are in the window rather than viewed
+    bool in_window() const noexcept;
+
     const uint8_t* data() const noexcept;
     int32_t size() const noexcept;
 };
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_BGZFBUFFERPOOL_HPP_
+#define LIBGENE_IO_BGZFBUFFERPOOL_HPP_
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+namespace gene {
+
+//
+// Free list of byte buffers which BGZF blocks borrow instead of allocating
+// their own for every block. Buffers only ever grow, so once the first few
+// blocks have been read nothing is allocated any more. Thread-safe.
+//
+class BgzfBufferPool {
+ public:
+    // Returns a buffer of at least 'size' bytes. Its contents are undefined.
+    std::vector<uint8_t> Acquire(size_t size);
+
+    void Release(std::vector<uint8_t>&& buffer);
+
+ private:
+    std::mutex mutex_;
+    std::vector<std::vector<uint8_t>> free_;
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_BGZFBUFFERPOOL_HPP_
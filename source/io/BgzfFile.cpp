@@ -17,34 +17,50 @@
 #include "BgzfFile.hpp"
 #include "../file/alignment/bam/BamUtils.hpp"
 #include "../log/Logger.hpp"
+#include "../utils/MiscPrimitives.hpp"
 
+#include <algorithm>
 #include <cstdint>
-#include <cstdlib>
+#include <cstring>
+#include <thread>
 #include <zlib.h>
 
 namespace gene {
 
 constexpr int32_t kGzipHeaderSize = 12;
 constexpr int32_t kExtraHeaderSize = 6;
+// Seeks to read less compressed data than this inflate blocks one by one
+constexpr int64_t kMinReadAheadSpan = 1 << 20;
 
-BgzfFile::BgzfFile(const std::string& path, OpenMode mode)
-: current_block_exhausted_(true), block_offset_(0)
+BgzfFile::BgzfFile(const std::string& path, OpenMode mode, IoBackend backend, int threads,
+                   bool verify_checksums)
+: verify_checksums_(verify_checksums), current_block_exhausted_(true), block_offset_(0)
 {
-    file_ = fopen(path.c_str(), (mode == OpenMode::Read ? "rb" : "wb"));
-    
-    if (!file_)
-        return;
-    
-    fseek(file_, 0L, SEEK_END);
-    file_size_ = ftell(file_);
-    fseek(file_, 0L, SEEK_SET);
+    if (mode == OpenMode::Read) {
+        input_ = InputBackend::Open(path, backend);
+        file_size_ = input_->length();
+        // Raw deflate: the gzip wrapper of every block is parsed here
+        if (inflateInit2(&inflate_stream_, -15) != Z_OK)
+            throw prim::UserVisibleError("Couldn't initialize decompression of '" + path + "'");
+
+        if (threads <= 0)
+            threads = std::thread::hardware_concurrency();
+        if (threads > 1) {
+            reader_ = std::make_unique<BgzfReader>(*input_, threads, verify_checksums_);
+            reading_ahead_ = true;
+        }
+    } else {
+        // Output goes through the BgzfStringOutputStream of the file's owner,
+        // which compresses blocks on its own workers
+        file_size_ = 0;
+    }
 }
 
 void BgzfFile::ReadCompressionBlock_()
 {
     uint8_t compressionBlock[kGzipHeaderSize];
-    int64_t read = fread(compressionBlock, 1, kGzipHeaderSize, file_);
-    if (read == 0) {
+    int64_t read = input_->Read(compressionBlock, kGzipHeaderSize);
+    if (read <= 0) {
         return;
     }
     
@@ -67,8 +83,8 @@ void BgzfFile::ReadCompressionBlock_()
 void BgzfFile::ReadExtraBlock_()
 {
     uint8_t extraBlock[kExtraHeaderSize];
-    int64_t read = fread(extraBlock, 1, kExtraHeaderSize, file_);
-    if (read == 0) {
+    int64_t read = input_->Read(extraBlock, kExtraHeaderSize);
+    if (read <= 0) {
         return;
     }
     
@@ -83,51 +99,156 @@ void BgzfFile::ReadExtraBlock_()
     extra_subfields_.blockSize = bmtls::getUint16(extraBlock + 4);
 }
 
-void BgzfFile::ReadFooter_()
+bool BgzfFile::ReadBlockInline_(int32_t carryover_length)
 {
-    uint8_t footer[8];
-    fread(footer, 1, 8, file_);
-    // uint32_t isize = bmtls::getUint32(footer + 4);
+    // A partial header at the end is a damaged block, not the end
+    const bool at_end = input_->position() == length();
+    ReadCompressionBlock_();
+    ReadExtraBlock_();
+    if (carryover_length == 0 && at_end)
+        return false;
+
+    if (!current_block->Read(*input_,
+                             extra_subfields_.blockSize,
+                             carryover_length,
+                             inflate_stream_,
+                             verify_checksums_)) {
+        PrintfLog("Damaged BGZF file. Couldn't read block at offset %lld.\n",
+                  static_cast<long long>(compressed_offset_));
+        damaged_ = true;
+        return false;
+    }
+    compressed_offset_ = input_->position();
+    return true;
 }
 
-bool BgzfFile::ReadNextBlock()
+bool BgzfFile::ReadBlockAhead_(int32_t carryover_length)
 {
-    ReadCompressionBlock_();
-    ReadExtraBlock_();
-    if (current_block) {
-        int carryOverSize = current_block->size() - block_offset_;
-        uint8_t* carryBlock;
-        if (carryOverSize > 0) {
-            carryBlock = (uint8_t*)malloc(carryOverSize);
-            std::memcpy(carryBlock, current_block->data() + block_offset_, carryOverSize);
-        } else {
-            if (position() == length()) {
-                return false;
-            }
-            carryOverSize = 0;
+    // A carryover read in place from the reader's ring keeps the blocks it's
+    // in until it has been moved or used up
+    bool carryover_in_ring = carryover_length > 0 && !current_block->in_window() &&
+                             !ring_blocks_.empty();
+    uint64_t keep_from = UINT64_MAX;
+    if (carryover_in_ring) {
+        int64_t kept = 0;
+        int kept_blocks = 0;
+        for (auto block = ring_blocks_.rbegin();
+             block != ring_blocks_.rend() && kept < carryover_length;
+             ++block) {
+            keep_from = block->number;
+            kept += block->size;
+            kept_blocks++;
         }
-        block_offset_ = 0;
-        current_block = std::make_unique<BgzfBlock>(file_,
-                                                    extra_subfields_.blockSize,
-                                                    carryOverSize,
-                                                    carryBlock);
-        if (carryOverSize > 0) {
-            free(carryBlock);
+        // A record spread over more (small) blocks than the reader can keep
+        // is copied out of the ring, and continued in the window from then on
+        if (kept_blocks > reader_->max_kept_blocks()) {
+            current_block->Detach(carryover_length);
+            carryover_in_ring = false;
+            keep_from = UINT64_MAX;
         }
+    }
+
+    BgzfReader::Block block;
+    if (!reader_->Next(block, keep_from)) {
+        damaged_ = reader_->damaged();
+        return false;
+    }
+    while (!ring_blocks_.empty() && ring_blocks_.front().number < keep_from)
+        ring_blocks_.pop_front();
+    ring_blocks_.push_back(block);
+    compressed_offset_ = block.end_offset;
+
+    if (carryover_length == 0) {
+        current_block->View(block.data, block.size, 0);
+        return true;
+    }
+
+    // Blocks follow each other in the ring, except after a wrap, when the
+    // carryover is moved in front of the ring's start. Only records too long
+    // for that are copied together with the blocks after them.
+    const uint8_t* carryover = current_block->data() + current_block->size() - carryover_length;
+    if (carryover_in_ring && carryover_length <= BgzfReader::kRingHeadroom) {
+        if (carryover + carryover_length != block.data)
+            std::memmove(block.data - carryover_length, carryover, carryover_length);
+        current_block->View(block.data, block.size, carryover_length);
     } else {
-        current_block = std::make_unique<BgzfBlock>(file_,
-                                                    extra_subfields_.blockSize,
-                                                    0,
-                                                    nullptr);
+        current_block->Assign(block.data, block.size, carryover_length);
     }
-    ReadFooter_();
+    return true;
+}
+
+bool BgzfFile::ReadNextBlock()
+{
+    int32_t carryover_length = 0;
+    if (current_block)
+        carryover_length = std::max(current_block->size() - block_offset_, 0);
+    else
+        current_block = std::make_unique<BgzfBlock>(buffer_pool_);
+
+    const uint64_t carryover_address = Tell();
+    const int64_t block_address = compressed_offset_;
+    if (!(reading_ahead_ ? ReadBlockAhead_(carryover_length) : ReadBlockInline_(carryover_length)))
+        return false;
+
+    block_address_ = block_address;
+    carryover_length_ = carryover_length;
+    carryover_address_ = carryover_address;
+    block_offset_ = 0;
     current_block_exhausted_ = false;
     return true;
 }
 
+uint64_t BgzfFile::Tell() const noexcept
+{
+    // Past the end of a block is the start of the next one, as for htslib
+    if (!current_block || block_offset_ >= current_block->size())
+        return static_cast<uint64_t>(compressed_offset_) << 16;
+    if (block_offset_ < carryover_length_)
+        return carryover_address_ + block_offset_;
+    return static_cast<uint64_t>(block_address_) << 16 | (block_offset_ - carryover_length_);
+}
+
+bool BgzfFile::Seek(uint64_t virtual_offset, uint64_t virtual_end)
+{
+    const int64_t address = static_cast<int64_t>(virtual_offset >> 16);
+    const int32_t offset = static_cast<int32_t>(virtual_offset & 0xFFFF);
+
+    // Index chunks and checkpoints often point into the block read last,
+    // which is still there
+    if (current_block && address == block_address_ &&
+        offset <= current_block->size() - carryover_length_) {
+        block_offset_ = carryover_length_ + offset;
+        current_block_exhausted_ = false;
+        return true;
+    }
+
+    if (reader_) {
+        reading_ahead_ = virtual_end == UINT64_MAX ||
+                         static_cast<int64_t>(virtual_end >> 16) - address >= kMinReadAheadSpan;
+        if (reading_ahead_ && !reader_->Restart(address))
+            return false;
+        if (!reading_ahead_)
+            reader_->Stop();
+    }
+    if (!reading_ahead_ && !input_->Seek(address))
+        return false;
+
+    // Nothing before the seek is carried over
+    ring_blocks_.clear();
+    damaged_ = false;
+    compressed_offset_ = address;
+    if (current_block)
+        block_offset_ = current_block->size();
+    if (!ReadNextBlock() || offset > current_block->size())
+        return false;
+
+    block_offset_ = offset;
+    return true;
+}
+
 int64_t BgzfFile::position() const noexcept
 {
-    return ftell(file_);
+    return compressed_offset_;
 }
 
 int64_t BgzfFile::length() const noexcept
@@ -137,9 +258,10 @@ int64_t BgzfFile::length() const noexcept
 
 BgzfFile::~BgzfFile() noexcept
 {
-    if (file_) {
-        fclose(file_);
-    }
+    // The reader's workers use the input
+    reader_.reset();
+    if (input_)
+        inflateEnd(&inflate_stream_);
 }
 
 }  // namespace gene
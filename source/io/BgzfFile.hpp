@@ -19,11 +19,17 @@
 
 #include <string>
 #include <memory>
+#include <deque>
+#include <cstdint>
+#include <zlib.h>
 
 #include "BgzfBlock.hpp"
+#include "BgzfBufferPool.hpp"
+#include "BgzfReader.hpp"
 #include "../file/alignment/sam/SamHeader.hpp"
 #include "../file/alignment/sam/SamRecord.hpp"
 #include "../io/IOFile.hpp"
+#include "backends/IoBackend.hpp"
 
 namespace gene {
 
@@ -48,24 +54,60 @@ class BgzfFile {
     } extra_subfields_;
     
     int64_t file_size_;
-    
+    // Offset just past the block read last
+    int64_t compressed_offset_{0};
+    // Where the block read last starts, and the virtual offset of the bytes
+    // carried over in front of it from the blocks before
+    int64_t block_address_{0};
+    int32_t carryover_length_{0};
+    uint64_t carryover_address_{0};
+    bool verify_checksums_;
+    // Shared by all blocks of the file instead of being set up for each one
+    BgzfBufferPool buffer_pool_;
+    z_stream inflate_stream_{};
+
     void ReadCompressionBlock_();
     void ReadExtraBlock_();
-    void ReadFooter_();
+    bool ReadBlockInline_(int32_t carryover_length);
+    bool ReadBlockAhead_(int32_t carryover_length);
 
  protected:
-    FILE* file_;
+    std::unique_ptr<InputBackend> input_;  // Read mode
+    // Inflates blocks ahead on worker threads; without it every block is
+    // inflated by ReadNextBlock() itself. Short seeks stop reading ahead.
+    std::unique_ptr<BgzfReader> reader_;
+    bool reading_ahead_{false};
+    // Blocks handed out by 'reader_' which the current block still views
+    std::deque<BgzfReader::Block> ring_blocks_;
     bool current_block_exhausted_;
     int32_t block_offset_;
+    // Set when ReadNextBlock() stopped at a damaged block instead of the end
+    // of the file
+    bool damaged_{false};
     std::unique_ptr<SamHeader> sam_header_;
 
  public:
-    BgzfFile(const std::string& path, OpenMode mode);
+    // 'threads' is the number of threads inflating blocks when reading: 1
+    // inflates them on the caller's thread, <= 0 uses all hardware threads.
+    // With 'verify_checksums' the CRC32 of every block is checked as well.
+    BgzfFile(const std::string& path, OpenMode mode, IoBackend backend = IoBackend::Stdio,
+             int threads = 1, bool verify_checksums = false);
     virtual ~BgzfFile() noexcept;
 
     bool ReadNextBlock();
     std::unique_ptr<BgzfBlock> current_block;
 
+    // BGZF virtual offset (block offset << 16 | offset within the inflated
+    // block) of the byte at 'block_offset_'. Within bytes carried over from
+    // earlier blocks it's only exact for the first one, which is where a
+    // record that didn't fit into its block starts.
+    uint64_t Tell() const noexcept;
+    // Makes the byte at 'virtual_offset' the one at 'block_offset_'. When
+    // the caller knows it will read only up to 'virtual_end', blocks aren't
+    // read ahead unless that's far enough away to make it worthwhile. Seeks
+    // within the block read last don't read anything.
+    bool Seek(uint64_t virtual_offset, uint64_t virtual_end = UINT64_MAX);
+
     int64_t length() const noexcept;
     int64_t position() const noexcept;
 };
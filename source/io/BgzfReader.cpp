@@ -0,0 +1,270 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+
+#include "BgzfReader.hpp"
+#include "BgzfBlock.hpp"
+#include "backends/IoBackend.hpp"
+#include "../file/alignment/bam/BamUtils.hpp"
+#include "../log/Logger.hpp"
+
+namespace gene {
+
+// Blocks in flight per worker, so that a slow block doesn't stall the others
+constexpr int kBlocksPerWorker = 4;
+// Leaves room for the blocks the caller keeps besides those read ahead
+constexpr size_t kMinRingBlocks = 16;
+
+BgzfReader::BgzfReader(InputBackend& input, int threads, bool verify_checksums)
+: input_(input)
+, verify_checksums_(verify_checksums)
+, read_offset_(input.position())
+{
+    thread_count_ = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    slots_.resize(thread_count_ * kBlocksPerWorker);
+    ring_size_ = static_cast<uint64_t>(std::max<size_t>(slots_.size(), kMinRingBlocks)) *
+                 kBgzfMaxBlockSize;
+    ring_ = std::make_unique<uint8_t[]>(kRingHeadroom + ring_size_);
+
+    StartWorkers_();
+}
+
+BgzfReader::~BgzfReader()
+{
+    StopWorkers_();
+}
+
+void BgzfReader::StartWorkers_()
+{
+    next_read_ = 0;
+    next_consumed_ = 0;
+    next_release_ = 0;
+    end_block_ = UINT64_MAX;
+    ring_head_ = 0;
+    ring_tail_ = 0;
+    stop_ = false;
+    damaged_ = false;
+    for (auto& slot : slots_)
+        slot.state = BlockState::Free;
+
+    for (int i = 0; i < thread_count_; ++i)
+        workers_.emplace_back(&BgzfReader::WorkerLoop_, this);
+}
+
+void BgzfReader::StopWorkers_()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    block_released_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+    workers_.clear();
+}
+
+void BgzfReader::Stop()
+{
+    StopWorkers_();
+}
+
+bool BgzfReader::Restart(int64_t offset)
+{
+    StopWorkers_();
+    bool sought = input_.Seek(offset);
+    read_offset_ = input_.position();
+    StartWorkers_();
+    return sought;
+}
+
+bool BgzfReader::ReadBlock_(Slot& slot)
+{
+    uint8_t header[kBgzfBlockHeaderSize];
+    int64_t read = input_.Read(header, kBgzfBlockHeaderSize);
+    if (read <= 0)
+        return false;
+
+    int32_t block_size = -1;
+    if (read == kBgzfBlockHeaderSize)
+        block_size = BgzfBlock::CompressedBlockSize(header);
+    if (block_size < 0) {
+        PrintfLog("Damaged BGZF file. Unexpected block header at offset %lld.\n",
+                  static_cast<long long>(read_offset_));
+        return false;
+    }
+
+    // Compressed data followed by the gzip footer
+    slot.compressed.resize(block_size - kBgzfBlockHeaderSize);
+    const int64_t size = slot.compressed.size();
+    if (input_.Read(slot.compressed.data(), size) != size) {
+        PrintfLog("Damaged BGZF file. Truncated block at offset %lld.\n",
+                  static_cast<long long>(read_offset_));
+        return false;
+    }
+    slot.size = static_cast<int32_t>(bmtls::getUint32(slot.compressed.data() + size - 4));
+    if (slot.size > kBgzfMaxBlockSize) {
+        PrintfLog("Damaged BGZF file. Block at offset %lld is too large.\n",
+                  static_cast<long long>(read_offset_));
+        return false;
+    }
+    read_offset_ += block_size;
+    slot.end_offset = read_offset_;
+    return true;
+}
+
+bool BgzfReader::PlaceBlock_(std::unique_lock<std::mutex>& lock, Slot& slot)
+{
+    // A block which doesn't fit before the end of the ring goes to its start
+    uint64_t start = ring_head_;
+    if (start % ring_size_ + slot.size > ring_size_)
+        start += ring_size_ - start % ring_size_;
+    const uint64_t end = start + slot.size;
+    block_released_.wait(lock, [this, end] {
+        return stop_ || end - ring_tail_ <= ring_size_;
+    });
+    if (stop_)
+        return false;
+
+    ring_head_ = end;
+    slot.ring_end = end;
+    slot.data = ring_.get() + kRingHeadroom + start % ring_size_;
+    return true;
+}
+
+bool BgzfReader::InflateBlock_(z_stream& stream, Slot& slot)
+{
+    if (inflateReset(&stream) != Z_OK)
+        return false;
+
+    stream.next_in = slot.compressed.data();
+    stream.avail_in = static_cast<uInt>(slot.compressed.size() - kBgzfBlockFooterSize);
+    // Exactly the room ISIZE asks for, as the next block follows
+    stream.next_out = slot.data;
+    stream.avail_out = static_cast<uInt>(slot.size);
+
+    int err = inflate(&stream, Z_FINISH);
+    slot.size = static_cast<int32_t>(stream.total_out);
+    return err == Z_STREAM_END &&
+           BgzfBlock::MatchesFooter(slot.compressed.data() + slot.compressed.size() - kBgzfBlockFooterSize,
+                                    slot.data, slot.size, verify_checksums_);
+}
+
+void BgzfReader::WorkerLoop_()
+{
+    z_stream stream{};
+    if (inflateInit2(&stream, -15) != Z_OK)
+        return;
+
+    const uint64_t slot_count = slots_.size();
+    while (true) {
+        Slot *slot;
+        {
+            // Blocks have to be read from the file in order, so the whole
+            // read is done under file_mutex_. Only inflation runs in parallel.
+            std::lock_guard<std::mutex> file_lock(file_mutex_);
+            uint64_t number;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                block_released_.wait(lock, [this, slot_count] {
+                    return stop_ ||
+                           next_read_ >= end_block_ ||
+                           slots_[next_read_ % slot_count].state == BlockState::Free;
+                });
+                if (stop_ || next_read_ >= end_block_)
+                    break;
+                number = next_read_;
+            }
+            slot = &slots_[number % slot_count];
+            bool read = ReadBlock_(*slot);
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!read) {
+                // ReadBlock_() reads nothing at the end of the file
+                damaged_ = read_offset_ != input_.length();
+                end_block_ = number;
+                block_ready_.notify_all();
+                block_released_.notify_all();
+                break;
+            }
+            if (!PlaceBlock_(lock, *slot))
+                break;
+            slot->state = BlockState::Inflating;
+            next_read_++;
+        }
+
+        bool inflated = InflateBlock_(stream, *slot);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            slot->state = inflated ? BlockState::Ready : BlockState::Damaged;
+        }
+        block_ready_.notify_all();
+    }
+    inflateEnd(&stream);
+}
+
+int BgzfReader::max_kept_blocks() const noexcept
+{
+    return static_cast<int>(slots_.size()) - thread_count_;
+}
+
+bool BgzfReader::damaged()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return damaged_;
+}
+
+bool BgzfReader::Next(Block& block, uint64_t keep_from)
+{
+    const uint64_t slot_count = slots_.size();
+    std::unique_lock<std::mutex> lock(mutex_);
+    const uint64_t release_end = std::min(keep_from, next_consumed_);
+    if (next_release_ < release_end) {
+        for (; next_release_ < release_end; ++next_release_) {
+            Slot& released = slots_[next_release_ % slot_count];
+            released.state = BlockState::Free;
+            ring_tail_ = released.ring_end;
+        }
+        block_released_.notify_all();
+    }
+
+    Slot& slot = slots_[next_consumed_ % slot_count];
+    block_ready_.wait(lock, [this, &slot] {
+        return next_consumed_ >= end_block_ ||
+               slot.state == BlockState::Ready ||
+               slot.state == BlockState::Damaged;
+    });
+    if (next_consumed_ >= end_block_)
+        return false;
+
+    if (slot.state == BlockState::Damaged) {
+        PrintfLog("Damaged BGZF file. Block ending at offset %lld doesn't inflate or doesn't match its footer.\n",
+                  static_cast<long long>(slot.end_offset));
+        // Nothing after a damaged block is handed out
+        damaged_ = true;
+        end_block_ = next_consumed_;
+        block_released_.notify_all();
+        return false;
+    }
+
+    block.data = slot.data;
+    block.size = slot.size;
+    block.end_offset = slot.end_offset;
+    block.number = next_consumed_++;
+    return true;
+}
+
+}  // namespace gene
@@ -0,0 +1,145 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_BGZFREADER_HPP_
+#define LIBGENE_IO_BGZFREADER_HPP_
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <zlib.h>
+
+namespace gene {
+
+class InputBackend;
+
+//
+// Reads BGZF blocks ahead of the caller. Worker threads read blocks from
+// the file in order and inflate them in parallel; Next() hands them out in
+// file order.
+// Blocks are inflated back to back into one ring buffer, where each one
+// directly follows the one before it unless it had to wrap around to the
+// start. The caller can keep blocks, so data running across block
+// boundaries can be read in place.
+//
+class BgzfReader {
+ public:
+    struct Block {
+        uint8_t *data{nullptr};
+        int32_t size{0};
+        // File offset just past the compressed block
+        int64_t end_offset{0};
+        // Counted from 0 in file order since the last (re)start
+        uint64_t number{0};
+    };
+
+    // Bytes in front of the ring which the caller may use, to move the end
+    // of the block before a wrap in front of the block at the start
+    static constexpr int32_t kRingHeadroom = 1 << 17;
+
+    // Reads 'input' from its current position on. 'input' has to outlive the
+    // reader and mustn't be used by anyone else while workers are running.
+    // 'threads' <= 0 uses one worker per hardware thread. With
+    // 'verify_checksums' the CRC32 of every block is checked too.
+    BgzfReader(InputBackend& input, int threads, bool verify_checksums = false);
+    ~BgzfReader();
+
+    BgzfReader(const BgzfReader&) = delete;
+    BgzfReader& operator=(const BgzfReader&) = delete;
+
+    // Waits for the next block in file order. Blocks handed out before are
+    // released, except those from number 'keep_from' on, which stay valid
+    // until a later call releases them. At most max_kept_blocks() may be
+    // kept at a time. Returns false at the end of the file or once a block
+    // turns out to be damaged, which is logged.
+    bool Next(Block& block, uint64_t keep_from = UINT64_MAX);
+
+    // Kept blocks hold on to their slots, so more of them would leave the
+    // workers no room to read ahead
+    int max_kept_blocks() const noexcept;
+
+    // Drops the blocks read ahead and starts over at 'offset', which has to
+    // be the beginning of a block.
+    bool Restart(int64_t offset);
+
+    // Stops reading ahead, which leaves the input to others until Restart()
+    void Stop();
+
+    // Whether Next() returned false because of a damaged block rather than
+    // the end of the file
+    bool damaged();
+
+ private:
+    enum class BlockState {
+        Free,
+        Inflating,
+        Ready,
+        Damaged
+    };
+
+    struct Slot {
+        std::vector<uint8_t> compressed;
+        // In the ring, which is taken as consumed up to 'ring_end'
+        uint8_t *data{nullptr};
+        uint64_t ring_end{0};
+        // ISIZE from the footer until the block has been inflated
+        int32_t size{0};
+        int64_t end_offset{0};
+        BlockState state{BlockState::Free};
+    };
+
+    bool ReadBlock_(Slot& slot);
+    // Waits for room for the block in the ring; false if stopped meanwhile
+    bool PlaceBlock_(std::unique_lock<std::mutex>& lock, Slot& slot);
+    bool InflateBlock_(z_stream& stream, Slot& slot);
+    void StartWorkers_();
+    void StopWorkers_();
+    void WorkerLoop_();
+
+    InputBackend& input_;
+    int thread_count_;
+    bool verify_checksums_;
+
+    // Blocks are numbered in file order; block 'n' lives in slots_[n % size].
+    // 'end_block_' is the number of blocks in the file once it's known.
+    // Blocks from 'next_release_' to 'next_consumed_' are held by the caller.
+    std::vector<Slot> slots_;
+    // 'ring_head_' and 'ring_tail_' count bytes placed and released since the
+    // (re)start, including what is skipped at the end of the ring on a wrap
+    std::unique_ptr<uint8_t[]> ring_;
+    uint64_t ring_size_{0};
+    uint64_t ring_head_{0};
+    uint64_t ring_tail_{0};
+    std::vector<std::thread> workers_;
+    std::mutex file_mutex_;
+    std::mutex mutex_;
+    std::condition_variable block_ready_;
+    std::condition_variable block_released_;
+    uint64_t next_read_{0};
+    uint64_t next_consumed_{0};
+    uint64_t next_release_{0};
+    uint64_t end_block_{UINT64_MAX};
+    int64_t read_offset_{0};
+    bool stop_{false};
+    bool damaged_{false};
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_BGZFREADER_HPP_
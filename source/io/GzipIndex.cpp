@@ -0,0 +1,213 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <sys/stat.h>
+
+#include "GzipIndex.hpp"
+
+namespace gene {
+
+static const char kIndexMagic[8] = {'G', 'Z', 'I', 'D', 'X', '0', '1', '\0'};
+
+namespace {
+
+// Identifies the version of the gzip file an index was built for
+struct FileStamp {
+    int64_t size{-1};
+    int64_t modification_time{-1};
+};
+
+FileStamp StampForFile(const std::string& path)
+{
+    FileStamp stamp;
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        stamp.size = st.st_size;
+        stamp.modification_time = st.st_mtime;
+    }
+    return stamp;
+}
+
+template <typename T>
+bool ReadValue(FILE *file, T& value)
+{
+    return fread(&value, sizeof(T), 1, file) == 1;
+}
+
+template <typename T>
+bool WriteValue(FILE *file, const T& value)
+{
+    return fwrite(&value, sizeof(T), 1, file) == 1;
+}
+
+}  // namespace
+
+GzipIndex::GzipIndex(int64_t span)
+: span_(span)
+{
+}
+
+std::string GzipIndex::PathForFile(const std::string& gz_path)
+{
+    return gz_path + ".gzidx";
+}
+
+std::unique_ptr<GzipIndex> GzipIndex::Load(const std::string& gz_path)
+{
+    FILE *file = fopen(PathForFile(gz_path).c_str(), "rb");
+    if (!file)
+        return nullptr;
+
+    const FileStamp stamp = StampForFile(gz_path);
+    char magic[sizeof(kIndexMagic)];
+    FileStamp saved_stamp;
+    int64_t span;
+    int64_t uncompressed_size;
+    int64_t count;
+    bool valid = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                 std::memcmp(magic, kIndexMagic, sizeof(magic)) == 0 &&
+                 ReadValue(file, saved_stamp.size) &&
+                 ReadValue(file, saved_stamp.modification_time) &&
+                 ReadValue(file, span) &&
+                 ReadValue(file, uncompressed_size) &&
+                 ReadValue(file, count) &&
+                 saved_stamp.size == stamp.size &&
+                 saved_stamp.modification_time == stamp.modification_time &&
+                 count >= 0;
+
+    auto index = std::make_unique<GzipIndex>(span);
+    for (int64_t i = 0; valid && i < count; ++i) {
+        Checkpoint checkpoint;
+        valid = ReadValue(file, checkpoint.uncompressed_offset) &&
+                ReadValue(file, checkpoint.compressed_offset) &&
+                ReadValue(file, checkpoint.bits) &&
+                ReadValue(file, checkpoint.window_size) &&
+                checkpoint.window_size >= 0 &&
+                checkpoint.window_size <= kWindowSize;
+        if (!valid)
+            break;
+
+        checkpoint.window = std::make_unique<uint8_t[]>(checkpoint.window_size);
+        valid = fread(checkpoint.window.get(), 1, checkpoint.window_size, file) ==
+                static_cast<size_t>(checkpoint.window_size);
+        index->checkpoints_.push_back(std::move(checkpoint));
+    }
+    fclose(file);
+
+    if (!valid)
+        return nullptr;
+
+    // Only complete indices are ever saved
+    index->SetComplete(uncompressed_size);
+    return index;
+}
+
+bool GzipIndex::Save(const std::string& gz_path) const
+{
+    FILE *file = fopen(PathForFile(gz_path).c_str(), "wb");
+    if (!file)
+        return false;
+
+    const FileStamp stamp = StampForFile(gz_path);
+    bool written = fwrite(kIndexMagic, 1, sizeof(kIndexMagic), file) == sizeof(kIndexMagic) &&
+                   WriteValue(file, stamp.size) &&
+                   WriteValue(file, stamp.modification_time) &&
+                   WriteValue(file, span_) &&
+                   WriteValue(file, uncompressed_size_) &&
+                   WriteValue(file, static_cast<int64_t>(checkpoints_.size()));
+
+    for (const auto& checkpoint : checkpoints_) {
+        if (!written)
+            break;
+        written = WriteValue(file, checkpoint.uncompressed_offset) &&
+                  WriteValue(file, checkpoint.compressed_offset) &&
+                  WriteValue(file, checkpoint.bits) &&
+                  WriteValue(file, checkpoint.window_size) &&
+                  fwrite(checkpoint.window.get(), 1, checkpoint.window_size, file) ==
+                  static_cast<size_t>(checkpoint.window_size);
+    }
+
+    if (fclose(file) != 0)
+        written = false;
+    if (!written)
+        remove(PathForFile(gz_path).c_str());
+    return written;
+}
+
+bool GzipIndex::CheckpointDue(int64_t uncompressed_offset) const noexcept
+{
+    if (checkpoints_.empty())
+        return uncompressed_offset >= span_;
+    return uncompressed_offset >= checkpoints_.back().uncompressed_offset + span_;
+}
+
+void GzipIndex::AddCheckpoint(int64_t uncompressed_offset,
+                              int64_t compressed_offset,
+                              int32_t bits,
+                              const uint8_t *window,
+                              int32_t window_size)
+{
+    Checkpoint checkpoint;
+    checkpoint.uncompressed_offset = uncompressed_offset;
+    checkpoint.compressed_offset = compressed_offset;
+    checkpoint.bits = bits;
+    checkpoint.window_size = window_size;
+    checkpoint.window = std::make_unique<uint8_t[]>(window_size);
+    std::memcpy(checkpoint.window.get(), window, window_size);
+    checkpoints_.push_back(std::move(checkpoint));
+}
+
+auto GzipIndex::Find(int64_t uncompressed_offset) const noexcept -> const Checkpoint*
+{
+    auto it = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), uncompressed_offset,
+                               [](int64_t offset, const Checkpoint& checkpoint) {
+        return offset < checkpoint.uncompressed_offset;
+    });
+    if (it == checkpoints_.begin())
+        return nullptr;
+    return &*std::prev(it);
+}
+
+bool GzipIndex::complete() const noexcept
+{
+    return complete_;
+}
+
+void GzipIndex::SetComplete(int64_t uncompressed_size)
+{
+    complete_ = true;
+    uncompressed_size_ = uncompressed_size;
+}
+
+int64_t GzipIndex::uncompressed_size() const noexcept
+{
+    return uncompressed_size_;
+}
+
+int64_t GzipIndex::span() const noexcept
+{
+    return span_;
+}
+
+size_t GzipIndex::size() const noexcept
+{
+    return checkpoints_.size();
+}
+
+}  // namespace gene
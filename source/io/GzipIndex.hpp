@@ -0,0 +1,88 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_GZIPINDEX_HPP_
+#define LIBGENE_IO_GZIPINDEX_HPP_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace gene {
+
+//
+// Random access index for plain gzip files, in the spirit of zlib's zran.c.
+// Each checkpoint sits on a deflate block boundary and keeps the 32K
+// window preceding it, so inflation can be restarted there instead of at
+// the beginning of the file. The index is saved next to the file, as
+// <file>.gzidx.
+//
+class GzipIndex {
+ public:
+    static constexpr int32_t kWindowSize = 32768;
+
+    struct Checkpoint {
+        int64_t uncompressed_offset;
+        // First full byte of the next deflate block
+        int64_t compressed_offset;
+        // Number of bits (0-7) of the byte before 'compressed_offset' which
+        // belong to the next block already
+        int32_t bits;
+        std::unique_ptr<uint8_t[]> window;
+        int32_t window_size;
+    };
+
+    // Checkpoints are made roughly every 'span' uncompressed bytes
+    explicit GzipIndex(int64_t span);
+
+    static std::string PathForFile(const std::string& gz_path);
+
+    // Returns nullptr if there's no index for the file, or if it was built
+    // for a different version of the file
+    static std::unique_ptr<GzipIndex> Load(const std::string& gz_path);
+    bool Save(const std::string& gz_path) const;
+
+    bool CheckpointDue(int64_t uncompressed_offset) const noexcept;
+    void AddCheckpoint(int64_t uncompressed_offset,
+                       int64_t compressed_offset,
+                       int32_t bits,
+                       const uint8_t *window,
+                       int32_t window_size);
+
+    // The last checkpoint at or before 'uncompressed_offset', or nullptr
+    const Checkpoint* Find(int64_t uncompressed_offset) const noexcept;
+
+    // Set once the whole file has been read with the index being built
+    bool complete() const noexcept;
+    void SetComplete(int64_t uncompressed_size);
+
+    // Only known for complete indices
+    int64_t uncompressed_size() const noexcept;
+
+    int64_t span() const noexcept;
+    size_t size() const noexcept;
+
+ private:
+    int64_t span_;
+    bool complete_{false};
+    int64_t uncompressed_size_{-1};
+    std::vector<Checkpoint> checkpoints_;
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_GZIPINDEX_HPP_
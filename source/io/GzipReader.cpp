@@ -0,0 +1,264 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "GzipReader.hpp"
+#include "../log/Logger.hpp"
+#include "../utils/MiscPrimitives.hpp"
+
+namespace gene {
+
+// Window bits for inflating a gzip (or zlib) stream with automatic detection
+constexpr int kGzipWindowBits = 15 + 32;
+// Window bits for inflating raw deflate data
+constexpr int kRawWindowBits = -15;
+constexpr int32_t kGzipTrailerSize = 8;
+
+GzipReader::GzipReader(const std::string& file_path, GzipIndex *index, IoBackend backend)
+: file_(InputBackend::Open(file_path, backend))
+, index_(index)
+{
+    if (inflateInit2(&stream_, kGzipWindowBits) != Z_OK)
+        throw prim::UserVisibleError("Couldn't initialize decompression of '" + file_path + "'");
+
+    input_ = std::make_unique<uint8_t[]>(kInputBufferSize);
+    window_ = std::make_unique<uint8_t[]>(GzipIndex::kWindowSize);
+    Rewind();
+}
+
+GzipReader::~GzipReader()
+{
+    inflateEnd(&stream_);
+}
+
+bool GzipReader::FillInput_()
+{
+    int64_t read = std::max<int64_t>(file_->Read(input_.get(), kInputBufferSize), 0);
+    input_offset_ += read;
+    stream_.next_in = input_.get();
+    stream_.avail_in = static_cast<uInt>(read);
+    return read > 0;
+}
+
+bool GzipReader::SkipInput_(int32_t bytes)
+{
+    while (bytes > 0) {
+        if (stream_.avail_in == 0 && !FillInput_())
+            return false;
+
+        uInt skipped = std::min(stream_.avail_in, static_cast<uInt>(bytes));
+        stream_.next_in += skipped;
+        stream_.avail_in -= skipped;
+        bytes -= skipped;
+    }
+    return true;
+}
+
+bool GzipReader::StartNextMember_()
+{
+    // zlib consumes the trailer itself only when it has parsed the header
+    if (raw_ && !SkipInput_(kGzipTrailerSize))
+        return false;
+
+    if (stream_.avail_in == 0 && !FillInput_())
+        return false;
+
+    // Anything but another gzip member after the end is ignored, like gzip does
+    if (stream_.next_in[0] != 0x1f)
+        return false;
+
+    raw_ = false;
+    return inflateReset2(&stream_, kGzipWindowBits) == Z_OK;
+}
+
+void GzipReader::AddCheckpoint_()
+{
+    uInt window_size = 0;
+    if (inflateGetDictionary(&stream_, window_.get(), &window_size) != Z_OK)
+        return;
+
+    index_->AddCheckpoint(output_offset_,
+                          compressed_offset(),
+                          stream_.data_type & 7,
+                          window_.get(),
+                          static_cast<int32_t>(window_size));
+}
+
+int64_t GzipReader::Read(char *out, int64_t size)
+{
+    if (transparent_) {
+        int64_t copied = std::min<int64_t>(size, stream_.avail_in);
+        std::memcpy(out, stream_.next_in, copied);
+        stream_.next_in += copied;
+        stream_.avail_in -= static_cast<uInt>(copied);
+        if (copied < size) {
+            int64_t read = std::max<int64_t>(file_->Read(out + copied, size - copied), 0);
+            input_offset_ += read;
+            copied += read;
+        }
+        output_offset_ += copied;
+        return copied;
+    }
+
+    int64_t produced = 0;
+    while (produced < size && !eof_) {
+        if (stream_.avail_in == 0 && !FillInput_()) {
+            PrintfLog("Unexpected end of compressed file at offset %lld.\n",
+                      static_cast<long long>(input_offset_));
+            eof_ = true;
+            break;
+        }
+
+        const uInt available = static_cast<uInt>(std::min<int64_t>(size - produced, UINT_MAX));
+        stream_.next_out = reinterpret_cast<Bytef *>(out + produced);
+        stream_.avail_out = available;
+
+        // Z_BLOCK stops at the end of every deflate block, which is where
+        // checkpoints can be made
+        int err = inflate(&stream_, building_index_ ? Z_BLOCK : Z_NO_FLUSH);
+        int64_t inflated = available - stream_.avail_out;
+        produced += inflated;
+        output_offset_ += inflated;
+
+        if (err == Z_STREAM_END) {
+            if (!StartNextMember_()) {
+                eof_ = true;
+                if (building_index_) {
+                    index_->SetComplete(output_offset_);
+                    building_index_ = false;
+                }
+            }
+            continue;
+        }
+        if (err != Z_OK && err != Z_BUF_ERROR) {
+            PrintfLog("Damaged compressed file. Couldn't inflate data at offset %lld.\n",
+                      static_cast<long long>(compressed_offset()));
+            eof_ = true;
+            return produced > 0 ? produced : -1;
+        }
+
+        // Bit 128: at the end of a block; bit 64: that was the last block
+        if (building_index_ &&
+            (stream_.data_type & 128) &&
+            !(stream_.data_type & 64) &&
+            index_->CheckpointDue(output_offset_)) {
+            AddCheckpoint_();
+        }
+    }
+    return produced;
+}
+
+void GzipReader::Rewind()
+{
+    file_->Seek(0);
+    input_offset_ = 0;
+    output_offset_ = 0;
+    stream_.next_in = input_.get();
+    stream_.avail_in = 0;
+    raw_ = false;
+    eof_ = false;
+    inflateReset2(&stream_, kGzipWindowBits);
+
+    FillInput_();
+    transparent_ = stream_.avail_in > 0 &&
+                   (stream_.avail_in < 2 || stream_.next_in[0] != 0x1f || stream_.next_in[1] != 0x8b);
+
+    // Checkpoints past the last one are correct however the reader got there,
+    // so the index keeps being built across seeks until it's complete
+    building_index_ = index_ && !index_->complete() && !transparent_;
+}
+
+bool GzipReader::Restore_(const GzipIndex::Checkpoint& checkpoint)
+{
+    // With 'bits' set, the checkpoint starts in the middle of the byte
+    // before 'compressed_offset'
+    const int64_t offset = checkpoint.compressed_offset - (checkpoint.bits ? 1 : 0);
+    if (!file_->Seek(offset))
+        return false;
+
+    input_offset_ = offset;
+    stream_.next_in = input_.get();
+    stream_.avail_in = 0;
+    eof_ = false;
+    if (inflateReset2(&stream_, kRawWindowBits) != Z_OK)
+        return false;
+    raw_ = true;
+
+    if (checkpoint.bits) {
+        uint8_t c;
+        if (file_->Read(&c, 1) != 1)
+            return false;
+        input_offset_++;
+        inflatePrime(&stream_, checkpoint.bits, c >> (8 - checkpoint.bits));
+    }
+    if (checkpoint.window_size > 0 &&
+        inflateSetDictionary(&stream_, checkpoint.window.get(), checkpoint.window_size) != Z_OK) {
+        return false;
+    }
+
+    output_offset_ = checkpoint.uncompressed_offset;
+    return true;
+}
+
+bool GzipReader::Seek(int64_t uncompressed_offset)
+{
+    if (transparent_) {
+        const int64_t offset = std::min(uncompressed_offset, file_->length());
+        file_->Seek(offset);
+        input_offset_ = offset;
+        output_offset_ = offset;
+        stream_.avail_in = 0;
+        return offset == uncompressed_offset;
+    }
+
+    // Going forward from the current position is cheaper than restarting,
+    // unless the index has a checkpoint in between
+    const GzipIndex::Checkpoint *checkpoint = index_ ? index_->Find(uncompressed_offset) : nullptr;
+    if (uncompressed_offset < output_offset_ ||
+        (checkpoint && checkpoint->uncompressed_offset > output_offset_)) {
+        if (!checkpoint || !Restore_(*checkpoint))
+            Rewind();
+    }
+
+    auto discarded = std::make_unique<char[]>(kInputBufferSize);
+    while (output_offset_ < uncompressed_offset) {
+        int64_t read = Read(discarded.get(),
+                            std::min<int64_t>(uncompressed_offset - output_offset_, kInputBufferSize));
+        if (read <= 0)
+            return false;
+    }
+    return true;
+}
+
+int64_t GzipReader::compressed_length() const noexcept
+{
+    return file_->length();
+}
+
+int64_t GzipReader::compressed_offset() const noexcept
+{
+    return input_offset_ - stream_.avail_in;
+}
+
+int64_t GzipReader::uncompressed_offset() const noexcept
+{
+    return output_offset_;
+}
+
+}  // namespace gene
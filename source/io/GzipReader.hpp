@@ -0,0 +1,89 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_GZIPREADER_HPP_
+#define LIBGENE_IO_GZIPREADER_HPP_
+
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <zlib.h>
+
+#include "GzipIndex.hpp"
+#include "backends/IoBackend.hpp"
+
+namespace gene {
+
+//
+// Sequential gzip reader (multi-member files included) which can seek to
+// uncompressed offsets with the help of a GzipIndex. If an incomplete index
+// is given, checkpoints are added to it while the file is read from the
+// beginning; the index is marked complete once the end is reached. Files
+// which aren't gzip compressed are read as is, like gzread() does.
+//
+class GzipReader {
+ public:
+    // 'index' may be nullptr, and has to outlive the reader otherwise
+    GzipReader(const std::string& file_path, GzipIndex *index,
+               IoBackend backend = IoBackend::Stdio);
+    ~GzipReader();
+
+    GzipReader(const GzipReader&) = delete;
+    GzipReader& operator=(const GzipReader&) = delete;
+
+    // Returns the number of bytes read, 0 at the end of the file or -1 on
+    // a decompression error
+    int64_t Read(char *out, int64_t size);
+
+    void Rewind();
+
+    // Restarts inflation at the closest checkpoint before the offset and
+    // skips the rest. Returns false if the file is shorter than that.
+    bool Seek(int64_t uncompressed_offset);
+
+    int64_t compressed_length() const noexcept;
+    int64_t compressed_offset() const noexcept;
+    int64_t uncompressed_offset() const noexcept;
+
+ private:
+    static constexpr int32_t kInputBufferSize = 1 << 17;
+
+    bool FillInput_();
+    bool SkipInput_(int32_t bytes);
+    bool StartNextMember_();
+    void AddCheckpoint_();
+    bool Restore_(const GzipIndex::Checkpoint& checkpoint);
+
+    std::unique_ptr<InputBackend> file_;
+    GzipIndex *index_;
+    z_stream stream_{};
+    std::unique_ptr<uint8_t[]> input_;
+    std::unique_ptr<uint8_t[]> window_;
+
+    // Input bytes read from the file, whether inflated yet or not
+    int64_t input_offset_{0};
+    int64_t output_offset_{0};
+    bool transparent_{false};
+    // Inflating raw deflate data after restoring a checkpoint, so the gzip
+    // trailer of the member has to be skipped by hand
+    bool raw_{false};
+    bool building_index_{false};
+    bool eof_{false};
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_GZIPREADER_HPP_
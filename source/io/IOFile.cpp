@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+
 #include "../io/IOFile.hpp"
 #include "../flags/CommandLineFlags.hpp"
 
@@ -34,6 +36,22 @@ IOFile::IOFile(const std::string& path,
     }
 }
 
+IOFile::IOFile(const std::string& path,
+               FileType type,
+               OpenMode mode,
+               const std::unique_ptr<CommandLineFlags>& flags)
+: type_(type), name_(path)
+{
+    switch (mode) {
+        case OpenMode::Read:
+            in_file_ = StringInputStream::StreamWithFileName(path, flags);
+            break;
+        case OpenMode::Write:
+            out_file_ = StringOutputStream::StreamWithFileName(path, flags);
+            break;
+    }
+}
+
 IOFile::IOFile(const std::string& path, FileType type)
 : type_(type), name_(path)
 {
@@ -92,4 +110,58 @@ void IOFile::ResetFilePointer()
         in_file_->ResetFilePointer();
 }
 
+int64_t IOFile::FindRecordStart_()
+{
+    return -1;
+}
+
+std::vector<ByteRange> IOFile::SplitIntoRanges(int count)
+{
+    if (!in_file_)
+        return {};
+
+    const int64_t start = in_file_->uncompressed_position();
+    const int64_t length = in_file_->uncompressed_length();
+    std::vector<ByteRange> ranges;
+    int64_t begin = start;
+
+    for (int i = 1; i < count && length > start; ++i) {
+        const int64_t target = start + (length - start) / count * i;
+        if (target <= begin)
+            continue;
+        if (!in_file_->Restrict(target, StringInputStream::kEndOfStream))
+            break;
+
+        // The target is most likely in the middle of a line
+        in_file_->ReadLineView();
+        const int64_t boundary = FindRecordStart_();
+        if (boundary < 0)
+            break;
+        if (boundary > begin) {
+            ranges.push_back({begin, boundary});
+            begin = boundary;
+        }
+    }
+    ranges.push_back({begin, StringInputStream::kEndOfStream});
+
+    in_file_->Restrict(start, StringInputStream::kEndOfStream);
+    return ranges;
+}
+
+bool IOFile::RestrictToRange(const ByteRange& range)
+{
+    if (!in_file_)
+        return false;
+
+    // The first range starts where SplitIntoRanges() was called, which may be
+    // before a header this instance has already read
+    const int64_t position = in_file_->uncompressed_position();
+    const int64_t begin = std::max(range.begin, position);
+
+    // Nothing to do for a single range, even if the stream can't seek
+    if (begin == position && range.end == StringInputStream::kEndOfStream)
+        return true;
+    return in_file_->Restrict(begin, range.end);
+}
+
 }  // namespace gene
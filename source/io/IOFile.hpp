@@ -18,8 +18,10 @@
 #define IOFile_hpp
 
 #include <string>
+#include <vector>
 #include <memory>
 #include <fstream>
+#include <cstdint>
 
 #include "streams/StringInputStream.hpp"
 #include "streams/StringOutputStream.hpp"
@@ -27,11 +29,20 @@
 
 namespace gene {
 
+class CommandLineFlags;
+
 enum class OpenMode {
     Read,
     Write
 };
 
+// Uncompressed bytes [begin, end) of a file. 'end' may be
+// StringInputStream::kEndOfStream.
+struct ByteRange {
+    int64_t begin;
+    int64_t end;
+};
+
 class IOFile {
  protected:
     std::unique_ptr<StringInputStream> in_file_;
@@ -39,8 +50,17 @@ class IOFile {
     std::string name_;
     FileType type_;
 
+    // Skips to the first record starting at or after the current position
+    // and returns its offset, or -1 if there's none or records can't be told
+    // apart in the middle of the file
+    virtual int64_t FindRecordStart_();
+
  public:
     IOFile(const std::string& path, FileType type, OpenMode mode);
+    IOFile(const std::string& path,
+           FileType type,
+           OpenMode mode,
+           const std::unique_ptr<CommandLineFlags>& flags);
     IOFile(const std::string& path, FileType type);
 
     virtual ~IOFile() noexcept;
@@ -52,6 +72,17 @@ class IOFile {
     virtual int64_t length() const;
     virtual int64_t position() const;
     void ResetFilePointer();
+
+    // Splits the records which are left into at most 'count' ranges of about
+    // the same size, each of them starting with a record. The ranges can be
+    // read in parallel by separate instances of the file (see
+    // RestrictToRange()). Files which can't seek or whose format can't be
+    // synchronized with come back as a single range.
+    virtual std::vector<ByteRange> SplitIntoRanges(int count);
+
+    // Only reads the records in 'range' from now on. Meant to be called right
+    // after opening the file (after its header has been read).
+    virtual bool RestrictToRange(const ByteRange& range);
 };
 
 }  // namespace gene
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MSC_VER
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "DirectBackend.hpp"
+#include "../../utils/MiscPrimitives.hpp"
+
+namespace gene {
+
+namespace {
+
+int OpenUncached(const std::string& file_path, int flags, mode_t mode = 0)
+{
+#ifdef O_DIRECT
+    int fd = open(file_path.c_str(), flags | O_DIRECT, mode);
+    if (fd < 0 && errno == EINVAL)
+        fd = open(file_path.c_str(), flags, mode);
+#else
+    int fd = open(file_path.c_str(), flags, mode);
+#ifdef F_NOCACHE
+    if (fd >= 0)
+        fcntl(fd, F_NOCACHE, 1);
+#endif  // F_NOCACHE
+#endif  // O_DIRECT
+    return fd;
+}
+
+}  // namespace
+
+DirectInputBackend::DirectInputBackend(const std::string& file_path)
+{
+    if (fd_ = OpenUncached(file_path, O_RDONLY | O_CLOEXEC); fd_ < 0)
+        throw prim::UserVisibleError("Couldn't open input file");
+
+    struct stat st;
+    if (fstat(fd_, &st) == 0)
+        length_ = st.st_size;
+
+    buffer_ = AllocateAligned(kBufferSize);
+}
+
+DirectInputBackend::~DirectInputBackend()
+{
+    close(fd_);
+}
+
+bool DirectInputBackend::FillBuffer_()
+{
+    buffer_offset_ = position_ & ~(kIoAlignment - 1);
+    buffer_size_ = 0;
+    while (buffer_size_ < kBufferSize) {
+        ssize_t read_bytes = pread(fd_, buffer_.get() + buffer_size_,
+                                   kBufferSize - buffer_size_,
+                                   buffer_offset_ + buffer_size_);
+        if (read_bytes < 0 && errno == EINTR)
+            continue;
+        if (read_bytes < 0)
+            return false;
+        // A short read that isn't aligned can only be the end of the file
+        buffer_size_ += read_bytes;
+        if (read_bytes == 0 || buffer_size_ % kIoAlignment != 0)
+            break;
+    }
+    return true;
+}
+
+int64_t DirectInputBackend::Read(void *out, int64_t size)
+{
+    int64_t total = 0;
+    while (total < size && position_ < length_) {
+        if (position_ < buffer_offset_ || position_ >= buffer_offset_ + buffer_size_) {
+            if (!FillBuffer_())
+                return total > 0 ? total : -1;
+            if (position_ >= buffer_offset_ + buffer_size_)
+                break;
+        }
+        const int64_t available = buffer_offset_ + buffer_size_ - position_;
+        const int64_t copied = std::min(available, size - total);
+        std::memcpy(static_cast<char *>(out) + total,
+                    buffer_.get() + (position_ - buffer_offset_), copied);
+        total += copied;
+        position_ += copied;
+    }
+    return total;
+}
+
+bool DirectInputBackend::Seek(int64_t offset)
+{
+    if (offset < 0)
+        return false;
+
+    // The buffer is kept: seeking back a little doesn't cost another read
+    position_ = offset;
+    return true;
+}
+
+DirectOutputBackend::DirectOutputBackend(const std::string& file_path)
+{
+    fd_ = OpenUncached(file_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd_ < 0)
+        throw prim::UserVisibleError("Couldn't open '" + file_path + "' for writing.\n\nCheck folder write permissions.");
+
+    buffer_ = AllocateAligned(kBufferSize);
+}
+
+DirectOutputBackend::~DirectOutputBackend()
+{
+    Close();
+}
+
+bool DirectOutputBackend::WriteBuffer_(int64_t size)
+{
+    int64_t total = 0;
+    while (total < size) {
+        ssize_t written = pwrite(fd_, buffer_.get() + total, size - total,
+                                 buffer_offset_ + total);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0) {
+            failed_ = true;
+            return false;
+        }
+        total += written;
+    }
+    return true;
+}
+
+bool DirectOutputBackend::Write(const void *data, int64_t size)
+{
+    if (failed_)
+        return false;
+
+    const char *bytes = static_cast<const char *>(data);
+    while (size > 0) {
+        const int64_t copied = std::min(size, kBufferSize - buffer_used_);
+        std::memcpy(buffer_.get() + buffer_used_, bytes, copied);
+        buffer_used_ += copied;
+        position_ += copied;
+        bytes += copied;
+        size -= copied;
+
+        if (buffer_used_ == kBufferSize) {
+            if (!WriteBuffer_(kBufferSize))
+                return false;
+            buffer_offset_ += kBufferSize;
+            buffer_used_ = 0;
+        }
+    }
+    return true;
+}
+
+bool DirectOutputBackend::Close()
+{
+    if (fd_ < 0)
+        return !failed_;
+
+    if (buffer_used_ > 0 && !failed_) {
+        const int64_t padded = (buffer_used_ + kIoAlignment - 1) & ~(kIoAlignment - 1);
+        std::memset(buffer_.get() + buffer_used_, 0, padded - buffer_used_);
+        if (WriteBuffer_(padded) && ftruncate(fd_, position_) != 0)
+            failed_ = true;
+        buffer_used_ = 0;
+    }
+    if (close(fd_) != 0)
+        failed_ = true;
+    fd_ = -1;
+    return !failed_;
+}
+
+}  // namespace gene
+
+#endif  // _MSC_VER
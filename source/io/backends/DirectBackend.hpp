@@ -0,0 +1,77 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_BACKENDS_DIRECTBACKEND_HPP_
+#define LIBGENE_IO_BACKENDS_DIRECTBACKEND_HPP_
+
+#include <string>
+
+#include "IoBackend.hpp"
+
+namespace gene {
+
+//
+// Bypasses the page cache: O_DIRECT on Linux, F_NOCACHE on macOS. Transfers
+// always go through an aligned buffer in whole multiples of kIoAlignment, so
+// callers can read and write any amount at any position. File systems that
+// refuse O_DIRECT (tmpfs, some network mounts) get the same transfers through
+// the page cache.
+//
+class DirectInputBackend final : public InputBackend {
+ public:
+    explicit DirectInputBackend(const std::string& file_path);
+    ~DirectInputBackend();
+
+    int64_t Read(void *out, int64_t size) override;
+    bool Seek(int64_t offset) override;
+
+ private:
+    static constexpr int64_t kBufferSize = 1 << 20;
+
+    // Reads the aligned window containing position_
+    bool FillBuffer_();
+
+    int fd_;
+    AlignedBuffer buffer_;
+    int64_t buffer_offset_{0};  // File offset of buffer_[0]
+    int64_t buffer_size_{0};
+};
+
+class DirectOutputBackend final : public OutputBackend {
+ public:
+    explicit DirectOutputBackend(const std::string& file_path);
+    ~DirectOutputBackend();
+
+    bool Write(const void *data, int64_t size) override;
+
+    // Pads the last block with zeroes and truncates the file back to size
+    bool Close() override;
+
+ private:
+    static constexpr int64_t kBufferSize = 1 << 20;
+
+    bool WriteBuffer_(int64_t size);
+
+    int fd_;
+    AlignedBuffer buffer_;
+    int64_t buffer_used_{0};
+    int64_t buffer_offset_{0};  // File offset of buffer_[0]
+    bool failed_{false};
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_BACKENDS_DIRECTBACKEND_HPP_
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdlib>
+#include <new>
+#ifdef _MSC_VER
+#include <malloc.h>
+#else
+#include <sys/stat.h>
+#endif  // _MSC_VER
+
+#include "IoBackend.hpp"
+#include "StdioBackend.hpp"
+#include "PosixBackend.hpp"
+#include "MappedBackend.hpp"
+#include "DirectBackend.hpp"
+#include "UringBackend.hpp"
+#include "../streams/MappedStringInputStream.hpp"
+#include "../../flags/CommandLineFlags.hpp"
+#include "../../def/Flags.hpp"
+#include "../../utils/MiscPrimitives.hpp"
+
+namespace gene {
+
+#ifndef _MSC_VER
+namespace {
+
+// io_uring and O_DIRECT transfer at explicit offsets, which pipes and
+// devices like /dev/stdout don't have. Files yet to be created are fine.
+bool IsPipeOrDevice(const std::string& file_path)
+{
+    struct stat st;
+    return stat(file_path.c_str(), &st) == 0 && !S_ISREG(st.st_mode);
+}
+
+}  // namespace
+#endif  // _MSC_VER
+
+void AlignedDeleter::operator()(char *memory) const noexcept
+{
+#ifdef _MSC_VER
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif  // _MSC_VER
+}
+
+AlignedBuffer AllocateAligned(int64_t size)
+{
+    void *memory = nullptr;
+#ifdef _MSC_VER
+    memory = _aligned_malloc(size, kIoAlignment);
+#else
+    if (posix_memalign(&memory, kIoAlignment, size) != 0)
+        memory = nullptr;
+#endif  // _MSC_VER
+    if (!memory)
+        throw std::bad_alloc();
+    return AlignedBuffer(static_cast<char *>(memory));
+}
+
+IoBackend IoBackendFromString(const std::string& name)
+{
+    if (name == "stdio")
+        return IoBackend::Stdio;
+    else if (name == "read")
+        return IoBackend::Posix;
+    else if (name == "mmap")
+        return IoBackend::Mmap;
+    else if (name == "io_uring")
+        return IoBackend::Uring;
+    else if (name == "direct")
+        return IoBackend::Direct;
+
+    throw prim::UserVisibleError("Unknown I/O backend '" + name +
+                                 "'. Use one of: stdio, read, mmap, io_uring, direct.");
+}
+
+IoBackend IoBackendFromFlags(const std::unique_ptr<CommandLineFlags>& flags)
+{
+    auto name = flags->GetSetting(Flags::kIoBackend);
+    if (!name)
+        return IoBackend::Stdio;
+    return IoBackendFromString(*name);
+}
+
+std::unique_ptr<InputBackend> InputBackend::Open(const std::string& file_path, IoBackend backend)
+{
+#ifdef _MSC_VER
+    return std::make_unique<StdioInputBackend>(file_path);
+#else
+    if ((backend == IoBackend::Uring || backend == IoBackend::Direct) && IsPipeOrDevice(file_path))
+        backend = IoBackend::Posix;
+
+    switch (backend) {
+        case IoBackend::Stdio:
+            return std::make_unique<StdioInputBackend>(file_path);
+        case IoBackend::Posix:
+            return std::make_unique<PosixInputBackend>(file_path);
+        case IoBackend::Mmap:
+            if (MappedStringInputStream::IsMappable(file_path))
+                return std::make_unique<MappedInputBackend>(file_path);
+            return std::make_unique<PosixInputBackend>(file_path);
+        case IoBackend::Uring:
+#ifdef __linux__
+            if (UringQueue::IsSupported())
+                return std::make_unique<UringInputBackend>(file_path);
+#endif  // __linux__
+            return std::make_unique<PosixInputBackend>(file_path);
+        case IoBackend::Direct:
+            return std::make_unique<DirectInputBackend>(file_path);
+    }
+    return std::make_unique<StdioInputBackend>(file_path);
+#endif  // _MSC_VER
+}
+
+int64_t InputBackend::length() const noexcept
+{
+    return length_;
+}
+
+int64_t InputBackend::position() const noexcept
+{
+    return position_;
+}
+
+std::unique_ptr<OutputBackend> OutputBackend::Open(const std::string& file_path,
+                                                   IoBackend backend,
+                                                   bool text)
+{
+#ifdef _MSC_VER
+    return std::make_unique<StdioOutputBackend>(file_path, text);
+#else
+    if ((backend == IoBackend::Uring || backend == IoBackend::Direct) && IsPipeOrDevice(file_path))
+        backend = IoBackend::Posix;
+
+    switch (backend) {
+        case IoBackend::Stdio:
+            return std::make_unique<StdioOutputBackend>(file_path, text);
+        case IoBackend::Posix:
+        case IoBackend::Mmap:
+            return std::make_unique<PosixOutputBackend>(file_path);
+        case IoBackend::Uring:
+#ifdef __linux__
+            if (UringQueue::IsSupported())
+                return std::make_unique<UringOutputBackend>(file_path);
+#endif  // __linux__
+            return std::make_unique<PosixOutputBackend>(file_path);
+        case IoBackend::Direct:
+            return std::make_unique<DirectOutputBackend>(file_path);
+    }
+    return std::make_unique<StdioOutputBackend>(file_path, text);
+#endif  // _MSC_VER
+}
+
+int64_t OutputBackend::position() const noexcept
+{
+    return position_;
+}
+
+}  // namespace gene
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_BACKENDS_IOBACKEND_HPP_
+#define LIBGENE_IO_BACKENDS_IOBACKEND_HPP_
+
+#include <string>
+#include <memory>
+#include <cstdint>
+
+namespace gene {
+
+class CommandLineFlags;
+
+//
+// The way bytes get from the disk into the streams and back. Backends which
+// aren't available on the platform (or refuse to start, like io_uring in
+// some containers) fall back to plain read(2)/write(2), or to stdio on
+// Windows.
+//
+enum class IoBackend {
+    Stdio,   // fread()/fwrite()
+    Posix,   // read(2)/write(2)
+    Mmap,    // Memory mapping (input only, output uses write(2))
+    Uring,   // io_uring with a queue of large reads/writes in flight (Linux)
+    Direct   // O_DIRECT (F_NOCACHE on macOS) with aligned buffers
+};
+
+// Alignment of buffers and file offsets for O_DIRECT transfers
+constexpr int64_t kIoAlignment = 4096;
+
+struct AlignedDeleter {
+    void operator()(char *memory) const noexcept;
+};
+using AlignedBuffer = std::unique_ptr<char[], AlignedDeleter>;
+
+// Throws std::bad_alloc
+AlignedBuffer AllocateAligned(int64_t size);
+
+// Parses the value of Flags::kIoBackend: "stdio", "read", "mmap", "io_uring"
+// or "direct". Throws prim::UserVisibleError for anything else.
+IoBackend IoBackendFromString(const std::string& name);
+
+// Stdio if the flag isn't set
+IoBackend IoBackendFromFlags(const std::unique_ptr<CommandLineFlags>& flags);
+
+class InputBackend {
+ protected:
+    int64_t length_{0};
+    int64_t position_{0};
+
+ public:
+    // Throws prim::UserVisibleError if the file can't be opened
+    static std::unique_ptr<InputBackend> Open(const std::string& file_path, IoBackend backend);
+
+    virtual ~InputBackend() = default;
+
+    // Reads 'size' bytes at the current position, or fewer at the end of the
+    // file. Returns -1 on error.
+    virtual int64_t Read(void *out, int64_t size) = 0;
+    virtual bool Seek(int64_t offset) = 0;
+
+    int64_t length() const noexcept;
+    int64_t position() const noexcept;
+};
+
+class OutputBackend {
+ protected:
+    int64_t position_{0};
+
+ public:
+    // Throws prim::UserVisibleError if the file can't be created. Only stdio
+    // makes a difference for 'text' (on Windows).
+    static std::unique_ptr<OutputBackend> Open(const std::string& file_path,
+                                               IoBackend backend,
+                                               bool text = false);
+
+    virtual ~OutputBackend() = default;
+
+    // Returns false on error. Data may still be in flight afterwards.
+    virtual bool Write(const void *data, int64_t size) = 0;
+
+    // Waits for all writes to complete and closes the file. Returns false if
+    // any write failed. Further calls do nothing.
+    virtual bool Close() = 0;
+
+    int64_t position() const noexcept;
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_BACKENDS_IOBACKEND_HPP_
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MSC_VER
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "MappedBackend.hpp"
+#include "../../utils/MiscPrimitives.hpp"
+
+namespace gene {
+
+MappedInputBackend::MappedInputBackend(const std::string& file_path)
+{
+    int fd = open(file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        throw prim::UserVisibleError("Couldn't open input file");
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw prim::UserVisibleError("Couldn't open input file");
+    }
+    length_ = st.st_size;
+
+    // The mapping stays valid after the descriptor is closed
+    void *mapping = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        throw prim::UserVisibleError("Couldn't map input file into memory");
+
+    data_ = static_cast<const char *>(mapping);
+    madvise(mapping, length_, MADV_SEQUENTIAL);
+}
+
+MappedInputBackend::~MappedInputBackend()
+{
+    munmap(const_cast<char *>(data_), length_);
+}
+
+int64_t MappedInputBackend::Read(void *out, int64_t size)
+{
+    const int64_t copied = std::clamp<int64_t>(length_ - position_, 0, size);
+    std::memcpy(out, data_ + position_, copied);
+    position_ += copied;
+    return copied;
+}
+
+bool MappedInputBackend::Seek(int64_t offset)
+{
+    if (offset < 0)
+        return false;
+
+    position_ = offset;
+    return true;
+}
+
+}  // namespace gene
+
+#endif  // _MSC_VER
@@ -0,0 +1,46 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_BACKENDS_MAPPEDBACKEND_HPP_
+#define LIBGENE_IO_BACKENDS_MAPPEDBACKEND_HPP_
+
+#include <string>
+
+#include "IoBackend.hpp"
+
+namespace gene {
+
+//
+// Reads by copying out of a memory mapping of the whole file, which saves
+// the read(2) calls. Plain text input uses MappedStringInputStream instead,
+// which doesn't even copy.
+//
+class MappedInputBackend final : public InputBackend {
+ public:
+    // The file must be mappable (see MappedStringInputStream::IsMappable())
+    explicit MappedInputBackend(const std::string& file_path);
+    ~MappedInputBackend();
+
+    int64_t Read(void *out, int64_t size) override;
+    bool Seek(int64_t offset) override;
+
+ private:
+    const char *data_{nullptr};
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_BACKENDS_MAPPEDBACKEND_HPP_
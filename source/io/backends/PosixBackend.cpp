@@ -0,0 +1,117 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MSC_VER
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "PosixBackend.hpp"
+#include "../../utils/MiscPrimitives.hpp"
+
+namespace gene {
+
+PosixInputBackend::PosixInputBackend(const std::string& file_path)
+{
+    if (fd_ = open(file_path.c_str(), O_RDONLY | O_CLOEXEC); fd_ < 0)
+        throw prim::UserVisibleError("Couldn't open input file");
+
+    struct stat st;
+    if (fstat(fd_, &st) == 0)
+        length_ = st.st_size;
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif  // POSIX_FADV_SEQUENTIAL
+}
+
+PosixInputBackend::~PosixInputBackend()
+{
+    close(fd_);
+}
+
+int64_t PosixInputBackend::Read(void *out, int64_t size)
+{
+    int64_t total = 0;
+    while (total < size) {
+        ssize_t read_bytes = read(fd_, static_cast<char *>(out) + total, size - total);
+        if (read_bytes < 0 && errno == EINTR)
+            continue;
+        if (read_bytes < 0)
+            return total > 0 ? total : -1;
+        if (read_bytes == 0)
+            break;
+        total += read_bytes;
+    }
+    position_ += total;
+    return total;
+}
+
+bool PosixInputBackend::Seek(int64_t offset)
+{
+    if (lseek(fd_, offset, SEEK_SET) < 0)
+        return false;
+
+    position_ = offset;
+    return true;
+}
+
+PosixOutputBackend::PosixOutputBackend(const std::string& file_path)
+{
+    fd_ = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd_ < 0)
+        throw prim::UserVisibleError("Couldn't open '" + file_path + "' for writing.\n\nCheck folder write permissions.");
+}
+
+PosixOutputBackend::~PosixOutputBackend()
+{
+    Close();
+}
+
+bool PosixOutputBackend::Write(const void *data, int64_t size)
+{
+    const char *bytes = static_cast<const char *>(data);
+    while (size > 0) {
+        ssize_t written = write(fd_, bytes, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0) {
+            failed_ = true;
+            return false;
+        }
+        bytes += written;
+        size -= written;
+        position_ += written;
+    }
+    return true;
+}
+
+bool PosixOutputBackend::Close()
+{
+    if (fd_ < 0)
+        return !failed_;
+
+    if (close(fd_) != 0)
+        failed_ = true;
+    fd_ = -1;
+    return !failed_;
+}
+
+}  // namespace gene
+
+#endif  // _MSC_VER
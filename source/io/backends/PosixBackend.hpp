@@ -0,0 +1,57 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_BACKENDS_POSIXBACKEND_HPP_
+#define LIBGENE_IO_BACKENDS_POSIXBACKEND_HPP_
+
+#include <string>
+
+#include "IoBackend.hpp"
+
+namespace gene {
+
+//
+// Unbuffered read(2)/write(2) on a file descriptor. The streams read and
+// write in large chunks already, so there's nothing for stdio to add.
+//
+class PosixInputBackend final : public InputBackend {
+ public:
+    explicit PosixInputBackend(const std::string& file_path);
+    ~PosixInputBackend();
+
+    int64_t Read(void *out, int64_t size) override;
+    bool Seek(int64_t offset) override;
+
+ private:
+    int fd_;
+};
+
+class PosixOutputBackend final : public OutputBackend {
+ public:
+    explicit PosixOutputBackend(const std::string& file_path);
+    ~PosixOutputBackend();
+
+    bool Write(const void *data, int64_t size) override;
+    bool Close() override;
+
+ private:
+    int fd_;
+    bool failed_{false};
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_BACKENDS_POSIXBACKEND_HPP_
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "StdioBackend.hpp"
+#include "../../utils/MiscPrimitives.hpp"
+
+namespace gene {
+
+StdioInputBackend::StdioInputBackend(const std::string& file_path)
+{
+    if (file_ = fopen(file_path.c_str(), "rb"); file_ == nullptr)
+        throw prim::UserVisibleError("Couldn't open input file");
+
+    fseek(file_, 0L, SEEK_END);
+    length_ = ftell(file_);
+    fseek(file_, 0L, SEEK_SET);
+}
+
+StdioInputBackend::~StdioInputBackend()
+{
+    fclose(file_);
+}
+
+int64_t StdioInputBackend::Read(void *out, int64_t size)
+{
+    size_t read = fread(out, 1, size, file_);
+    if (read == 0 && ferror(file_))
+        return -1;
+
+    position_ += read;
+    return read;
+}
+
+bool StdioInputBackend::Seek(int64_t offset)
+{
+    if (fseek(file_, offset, SEEK_SET) != 0)
+        return false;
+
+    clearerr(file_);
+    position_ = offset;
+    return true;
+}
+
+StdioOutputBackend::StdioOutputBackend(const std::string& file_path, bool text)
+{
+    if (file_ = fopen(file_path.c_str(), text ? "wt" : "wb"); file_ == nullptr)
+        throw prim::UserVisibleError("Couldn't open '" + file_path + "' for writing.\n\nCheck folder write permissions.");
+}
+
+StdioOutputBackend::~StdioOutputBackend()
+{
+    Close();
+}
+
+bool StdioOutputBackend::Write(const void *data, int64_t size)
+{
+    size_t written = fwrite(data, 1, size, file_);
+    position_ += written;
+    return written == static_cast<size_t>(size);
+}
+
+bool StdioOutputBackend::Close()
+{
+    if (!file_)
+        return true;
+
+    bool closed = fclose(file_) == 0;
+    file_ = nullptr;
+    return closed;
+}
+
+}  // namespace gene
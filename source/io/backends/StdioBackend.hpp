@@ -0,0 +1,53 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_BACKENDS_STDIOBACKEND_HPP_
+#define LIBGENE_IO_BACKENDS_STDIOBACKEND_HPP_
+
+#include <string>
+#include <cstdio>
+
+#include "IoBackend.hpp"
+
+namespace gene {
+
+class StdioInputBackend final : public InputBackend {
+ public:
+    explicit StdioInputBackend(const std::string& file_path);
+    ~StdioInputBackend();
+
+    int64_t Read(void *out, int64_t size) override;
+    bool Seek(int64_t offset) override;
+
+ private:
+    FILE *file_;
+};
+
+class StdioOutputBackend final : public OutputBackend {
+ public:
+    StdioOutputBackend(const std::string& file_path, bool text);
+    ~StdioOutputBackend();
+
+    bool Write(const void *data, int64_t size) override;
+    bool Close() override;
+
+ private:
+    FILE *file_;
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_BACKENDS_STDIOBACKEND_HPP_
@@ -0,0 +1,441 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "UringBackend.hpp"
+#include "../../utils/MiscPrimitives.hpp"
+
+namespace gene {
+
+namespace {
+
+template <typename T>
+T *RingField(void *ring, uint32_t offset)
+{
+    return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+}
+
+}  // namespace
+
+bool UringQueue::IsSupported()
+{
+    static const bool supported = [] {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, 2, &params));
+        if (fd < 0)
+            return false;
+
+        // IORING_OP_READ/WRITE and the probe itself arrived in the same kernel
+        const size_t probe_size = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+        std::vector<char> memory(probe_size, 0);
+        auto *probe = reinterpret_cast<io_uring_probe *>(memory.data());
+        bool result = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) == 0 &&
+                      probe->last_op >= IORING_OP_WRITE &&
+                      (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) &&
+                      (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+        close(fd);
+        return result;
+    }();
+    return supported;
+}
+
+UringQueue::UringQueue(unsigned entries)
+{
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0)
+        throw prim::UserVisibleError("Couldn't set up an io_uring queue");
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+        sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+
+    sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED) {
+        sq_ring_ = nullptr;
+        close(fd_);
+        throw prim::UserVisibleError("Couldn't set up an io_uring queue");
+    }
+    if (single_mmap) {
+        cq_ring_ = sq_ring_;
+    } else {
+        cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cq_ring_ == MAP_FAILED) {
+            munmap(sq_ring_, sq_ring_size_);
+            close(fd_);
+            throw prim::UserVisibleError("Couldn't set up an io_uring queue");
+        }
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        if (cq_ring_ != sq_ring_)
+            munmap(cq_ring_, cq_ring_size_);
+        munmap(sq_ring_, sq_ring_size_);
+        close(fd_);
+        throw prim::UserVisibleError("Couldn't set up an io_uring queue");
+    }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    sq_head_ = RingField<unsigned>(sq_ring_, params.sq_off.head);
+    sq_tail_ = RingField<unsigned>(sq_ring_, params.sq_off.tail);
+    sq_mask_ = RingField<unsigned>(sq_ring_, params.sq_off.ring_mask);
+    sq_array_ = RingField<unsigned>(sq_ring_, params.sq_off.array);
+    cq_head_ = RingField<unsigned>(cq_ring_, params.cq_off.head);
+    cq_tail_ = RingField<unsigned>(cq_ring_, params.cq_off.tail);
+    cq_mask_ = RingField<unsigned>(cq_ring_, params.cq_off.ring_mask);
+    cqes_ = RingField<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+}
+
+UringQueue::~UringQueue()
+{
+    munmap(sqes_, sqes_size_);
+    if (cq_ring_ != sq_ring_)
+        munmap(cq_ring_, cq_ring_size_);
+    munmap(sq_ring_, sq_ring_size_);
+    close(fd_);
+}
+
+io_uring_sqe *UringQueue::NextSqe_()
+{
+    // Only this thread moves the tail
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & *sq_mask_;
+    io_uring_sqe *sqe = &sqes_[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[index] = index;
+    return sqe;
+}
+
+void UringQueue::QueueRead(int fd, void *buffer, uint32_t size, int64_t offset, uint64_t tag)
+{
+    io_uring_sqe *sqe = NextSqe_();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = size;
+    sqe->off = offset;
+    sqe->user_data = tag;
+    __atomic_store_n(sq_tail_, *sq_tail_ + 1, __ATOMIC_RELEASE);
+    ++pending_;
+}
+
+void UringQueue::QueueWrite(int fd, const void *buffer, uint32_t size, int64_t offset, uint64_t tag)
+{
+    io_uring_sqe *sqe = NextSqe_();
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer);
+    sqe->len = size;
+    sqe->off = offset;
+    sqe->user_data = tag;
+    __atomic_store_n(sq_tail_, *sq_tail_ + 1, __ATOMIC_RELEASE);
+    ++pending_;
+}
+
+bool UringQueue::Enter_(unsigned min_complete)
+{
+    const unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    for (;;) {
+        long submitted = syscall(__NR_io_uring_enter, fd_, pending_, min_complete,
+                                 flags, nullptr, 0);
+        if (submitted < 0 && errno == EINTR)
+            continue;
+        if (submitted < 0)
+            return false;
+        pending_ -= static_cast<unsigned>(submitted);
+        return true;
+    }
+}
+
+bool UringQueue::Submit()
+{
+    return pending_ == 0 || Enter_(0);
+}
+
+bool UringQueue::PopCompletion_(uint64_t *tag, int32_t *result)
+{
+    const unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+        return false;
+
+    const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+    *tag = cqe.user_data;
+    *result = cqe.res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool UringQueue::WaitCompletion(uint64_t *tag, int32_t *result)
+{
+    while (!PopCompletion_(tag, result))
+        if (!Enter_(1))
+            return false;
+    return true;
+}
+
+UringInputBackend::UringInputBackend(const std::string& file_path)
+{
+    if (fd_ = open(file_path.c_str(), O_RDONLY | O_CLOEXEC); fd_ < 0)
+        throw prim::UserVisibleError("Couldn't open input file");
+
+    struct stat st;
+    if (fstat(fd_, &st) == 0)
+        length_ = st.st_size;
+
+    for (auto& slot : slots_)
+        slot.buffer = AllocateAligned(kSlotSize);
+}
+
+UringInputBackend::~UringInputBackend()
+{
+    Drain_();
+    close(fd_);
+}
+
+void UringInputBackend::QueueReads_()
+{
+    while (queued_ < kSlots && next_offset_ < length_) {
+        const int index = (head_ + queued_) % kSlots;
+        Slot& slot = slots_[index];
+        slot.offset = next_offset_;
+        slot.size = std::min(kSlotSize, length_ - next_offset_);
+        slot.done = false;
+        queue_.QueueRead(fd_, slot.buffer.get(), static_cast<uint32_t>(slot.size),
+                         slot.offset, index);
+        next_offset_ += slot.size;
+        ++queued_;
+    }
+    queue_.Submit();
+}
+
+bool UringInputBackend::WaitForSlot_(Slot& slot)
+{
+    while (!slot.done) {
+        uint64_t tag;
+        int32_t result;
+        if (!queue_.WaitCompletion(&tag, &result))
+            return false;
+        slots_[tag].result = result;
+        slots_[tag].done = true;
+    }
+    if (slot.result < 0)
+        return false;
+
+    // Finish short reads synchronously; they're rare for regular files
+    int64_t filled = slot.result;
+    while (filled < slot.size) {
+        ssize_t read_bytes = pread(fd_, slot.buffer.get() + filled, slot.size - filled,
+                                   slot.offset + filled);
+        if (read_bytes < 0 && errno == EINTR)
+            continue;
+        if (read_bytes < 0)
+            return false;
+        if (read_bytes == 0)
+            break;
+        filled += read_bytes;
+    }
+    slot.size = filled;
+    slot.result = static_cast<int32_t>(filled);
+    return true;
+}
+
+int64_t UringInputBackend::Read(void *out, int64_t size)
+{
+    int64_t total = 0;
+    while (total < size && position_ < length_) {
+        if (queued_ == 0)
+            QueueReads_();
+        if (queued_ == 0)
+            break;
+
+        Slot& slot = slots_[head_];
+        if (!WaitForSlot_(slot))
+            return total > 0 ? total : -1;
+
+        const int64_t available = slot.offset + slot.size - position_;
+        const int64_t copied = std::min(available, size - total);
+        std::memcpy(static_cast<char *>(out) + total,
+                    slot.buffer.get() + (position_ - slot.offset), copied);
+        total += copied;
+        position_ += copied;
+
+        if (position_ == slot.offset + slot.size) {
+            head_ = (head_ + 1) % kSlots;
+            --queued_;
+            if (slot.size < kSlotSize) {
+                // The file ended early
+                length_ = position_;
+                break;
+            }
+            QueueReads_();
+        }
+    }
+    return total;
+}
+
+void UringInputBackend::Drain_()
+{
+    for (int i = 0; i < queued_; ++i) {
+        Slot& slot = slots_[(head_ + i) % kSlots];
+        while (!slot.done) {
+            uint64_t tag;
+            int32_t result;
+            if (!queue_.WaitCompletion(&tag, &result))
+                return;
+            slots_[tag].done = true;
+        }
+    }
+    head_ = 0;
+    queued_ = 0;
+}
+
+bool UringInputBackend::Seek(int64_t offset)
+{
+    if (offset < 0)
+        return false;
+
+    Drain_();
+    position_ = offset;
+    next_offset_ = offset;
+    return true;
+}
+
+UringOutputBackend::UringOutputBackend(const std::string& file_path)
+{
+    fd_ = open(file_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd_ < 0)
+        throw prim::UserVisibleError("Couldn't open '" + file_path + "' for writing.\n\nCheck folder write permissions.");
+
+    for (auto& slot : slots_) {
+        slot.buffer = AllocateAligned(kSlotSize);
+        slot.in_flight = false;
+    }
+}
+
+UringOutputBackend::~UringOutputBackend()
+{
+    Close();
+}
+
+void UringOutputBackend::QueueWrite_(Slot& slot, int64_t size)
+{
+    slot.offset = position_ - size;
+    slot.size = size;
+    slot.in_flight = true;
+    ++in_flight_;
+    queue_.QueueWrite(fd_, slot.buffer.get(), static_cast<uint32_t>(size), slot.offset,
+                      &slot - slots_.data());
+    if (!queue_.Submit())
+        failed_ = true;
+}
+
+void UringOutputBackend::WaitOne_()
+{
+    uint64_t tag;
+    int32_t result;
+    if (!queue_.WaitCompletion(&tag, &result)) {
+        // Nothing more will complete; don't wait for it
+        failed_ = true;
+        in_flight_ = 0;
+        for (auto& slot : slots_)
+            slot.in_flight = false;
+        return;
+    }
+    Slot& slot = slots_[tag];
+    slot.in_flight = false;
+    --in_flight_;
+    if (result < 0) {
+        failed_ = true;
+        return;
+    }
+
+    int64_t written = result;
+    while (written < slot.size) {
+        ssize_t bytes = pwrite(fd_, slot.buffer.get() + written, slot.size - written,
+                               slot.offset + written);
+        if (bytes < 0 && errno == EINTR)
+            continue;
+        if (bytes <= 0) {
+            failed_ = true;
+            return;
+        }
+        written += bytes;
+    }
+}
+
+bool UringOutputBackend::Write(const void *data, int64_t size)
+{
+    const char *bytes = static_cast<const char *>(data);
+    while (size > 0 && !failed_) {
+        Slot& slot = slots_[current_];
+        const int64_t copied = std::min(size, kSlotSize - used_);
+        std::memcpy(slot.buffer.get() + used_, bytes, copied);
+        used_ += copied;
+        position_ += copied;
+        bytes += copied;
+        size -= copied;
+
+        if (used_ == kSlotSize) {
+            QueueWrite_(slot, used_);
+            used_ = 0;
+            current_ = (current_ + 1) % kSlots;
+            while (slots_[current_].in_flight)
+                WaitOne_();
+        }
+    }
+    return !failed_;
+}
+
+bool UringOutputBackend::Close()
+{
+    if (fd_ < 0)
+        return !failed_;
+
+    if (used_ > 0 && !failed_)
+        QueueWrite_(slots_[current_], used_);
+    used_ = 0;
+    while (in_flight_ > 0)
+        WaitOne_();
+
+    if (close(fd_) != 0)
+        failed_ = true;
+    fd_ = -1;
+    return !failed_;
+}
+
+}  // namespace gene
+
+#endif  // __linux__
@@ -0,0 +1,161 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_BACKENDS_URINGBACKEND_HPP_
+#define LIBGENE_IO_BACKENDS_URINGBACKEND_HPP_
+
+#ifdef __linux__
+
+#include <array>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+#include "IoBackend.hpp"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace gene {
+
+//
+// A minimal io_uring submission/completion queue pair, set up with the raw
+// system calls so there's no dependency on liburing. Not thread-safe.
+//
+class UringQueue {
+ public:
+    // Whether the kernel has io_uring with plain reads and writes (5.6+) and
+    // lets us use it (container seccomp profiles often don't). Probed once.
+    static bool IsSupported();
+
+    // Throws prim::UserVisibleError if the queue can't be set up
+    explicit UringQueue(unsigned entries);
+    ~UringQueue();
+
+    UringQueue(const UringQueue&) = delete;
+    UringQueue& operator=(const UringQueue&) = delete;
+
+    // The caller keeps no more than 'entries' requests in flight
+    void QueueRead(int fd, void *buffer, uint32_t size, int64_t offset, uint64_t tag);
+    void QueueWrite(int fd, const void *buffer, uint32_t size, int64_t offset, uint64_t tag);
+
+    // Hands the queued requests to the kernel
+    bool Submit();
+
+    // Blocks until a request completes. 'result' is what read(2)/write(2)
+    // would have returned, or -errno.
+    bool WaitCompletion(uint64_t *tag, int32_t *result);
+
+ private:
+    io_uring_sqe *NextSqe_();
+    bool PopCompletion_(uint64_t *tag, int32_t *result);
+    bool Enter_(unsigned min_complete);
+
+    int fd_{-1};
+    void *sq_ring_{nullptr};
+    size_t sq_ring_size_{0};
+    void *cq_ring_{nullptr};
+    size_t cq_ring_size_{0};
+    io_uring_sqe *sqes_{nullptr};
+    size_t sqes_size_{0};
+
+    unsigned *sq_head_;
+    unsigned *sq_tail_;
+    unsigned *sq_mask_;
+    unsigned *sq_array_;
+    unsigned *cq_head_;
+    unsigned *cq_tail_;
+    unsigned *cq_mask_;
+    io_uring_cqe *cqes_;
+    unsigned pending_{0};  // Queued but not submitted yet
+};
+
+//
+// Keeps kSlots sequential reads of kSlotSize bytes in flight ahead of the
+// position being read, so the disk is never idle while the caller parses.
+//
+class UringInputBackend final : public InputBackend {
+ public:
+    explicit UringInputBackend(const std::string& file_path);
+    ~UringInputBackend();
+
+    int64_t Read(void *out, int64_t size) override;
+    bool Seek(int64_t offset) override;
+
+ private:
+    static constexpr int kSlots = 8;
+    static constexpr int64_t kSlotSize = 1 << 20;
+
+    struct Slot {
+        AlignedBuffer buffer;
+        int64_t offset;
+        int64_t size;
+        int32_t result;
+        bool done;
+    };
+
+    void QueueReads_();
+    bool WaitForSlot_(Slot& slot);
+    void Drain_();
+
+    int fd_;
+    UringQueue queue_{kSlots};
+    std::array<Slot, kSlots> slots_;
+    int head_{0};    // The slot at position_
+    int queued_{0};  // Slots holding data at or after position_, in order
+    int64_t next_offset_{0};
+};
+
+//
+// Copies writes into one of kSlots buffers and queues each full buffer as a
+// single write, only blocking when every buffer is still in flight.
+//
+class UringOutputBackend final : public OutputBackend {
+ public:
+    explicit UringOutputBackend(const std::string& file_path);
+    ~UringOutputBackend();
+
+    bool Write(const void *data, int64_t size) override;
+    bool Close() override;
+
+ private:
+    static constexpr int kSlots = 8;
+    static constexpr int64_t kSlotSize = 1 << 20;
+
+    struct Slot {
+        AlignedBuffer buffer;
+        int64_t offset;
+        int64_t size;
+        bool in_flight;
+    };
+
+    void QueueWrite_(Slot& slot, int64_t size);
+    void WaitOne_();
+
+    int fd_;
+    UringQueue queue_{kSlots};
+    std::array<Slot, kSlots> slots_;
+    int current_{0};
+    int64_t used_{0};  // Bytes in slots_[current_]
+    int in_flight_{0};
+    bool failed_{false};
+};
+
+}  // namespace gene
+
+#endif  // __linux__
+
+#endif  // LIBGENE_IO_BACKENDS_URINGBACKEND_HPP_
@@ -0,0 +1,120 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string>
+#include <cstdio>
+
+#include "BgzfStringInputStream.hpp"
+#include "../BgzfBlock.hpp"
+
+namespace gene {
+
+BgzfStringInputStream::BgzfStringInputStream(const std::string& file_path, int threads,
+                                             IoBackend backend, bool verify_checksums)
+: StringInputStream(file_path)
+, input_(InputBackend::Open(file_path, backend))
+{
+    length_ = input_->length();
+    reader_ = std::make_unique<BgzfReader>(*input_, threads, verify_checksums);
+}
+
+BgzfStringInputStream::~BgzfStringInputStream()
+{
+    // The reader's workers use the input
+    reader_.reset();
+}
+
+bool BgzfStringInputStream::IsBgzf(const std::string& file_path)
+{
+    FILE *file = fopen(file_path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    uint8_t header[kBgzfBlockHeaderSize];
+    bool bgzf = fread(header, 1, kBgzfBlockHeaderSize, file) == kBgzfBlockHeaderSize &&
+                BgzfBlock::CompressedBlockSize(header) > 0;
+    fclose(file);
+    return bgzf;
+}
+
+bool BgzfStringInputStream::FillBuffer_()
+{
+    uncompressed_offset_ += read_;
+    pos_ = 0;
+    read_ = 0;
+
+    if (eof_)
+        return false;
+
+    BgzfReader::Block block;
+    while (reader_->Next(block)) {
+        compressed_offset_ = block.end_offset;
+
+        // Empty blocks (like the EOF marker) are skipped
+        if (block.size > 0) {
+            data_ = reinterpret_cast<const char *>(block.data);
+            read_ = block.size;
+            return true;
+        }
+    }
+    eof_ = true;
+    return false;
+}
+
+std::string_view BgzfStringInputStream::ReadLineView()
+{
+    return ReadBufferedLineView_();
+}
+
+std::string BgzfStringInputStream::ReadLine()
+{
+    return std::string(ReadLineView());
+}
+
+int BgzfStringInputStream::Peek()
+{
+    if (pos_ >= read_ && !FillBuffer_())
+        return EOF;
+
+    return data_[pos_];
+}
+
+void BgzfStringInputStream::ResetFilePointer()
+{
+    reader_->Restart(0);
+    pos_ = 0;
+    read_ = 0;
+    eof_ = false;
+    compressed_offset_ = 0;
+    uncompressed_offset_ = 0;
+}
+
+bool BgzfStringInputStream::empty() const
+{
+    return eof_ && pos_ >= read_;
+}
+
+int64_t BgzfStringInputStream::position() const noexcept
+{
+    return compressed_offset_;
+}
+
+int64_t BgzfStringInputStream::uncompressed_position() const noexcept
+{
+    return uncompressed_offset_ + pos_;
+}
+
+}  // namespace gene
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_STREAMS_BGZFSTRINGINPUTSTREAM_HPP_
+#define LIBGENE_IO_STREAMS_BGZFSTRINGINPUTSTREAM_HPP_
+
+#include <string>
+#include <string_view>
+#include <memory>
+
+#include "StringInputStream.hpp"
+#include "../BgzfReader.hpp"
+#include "../backends/IoBackend.hpp"
+
+namespace gene {
+
+//
+// Input stream over a BGZF-compressed text file (e.g. a bgzipped FASTQ).
+// BGZF blocks are independent deflate streams, so a BgzfReader inflates them
+// in parallel while the caller parses lines out of them in file order.
+//
+class BgzfStringInputStream final : public StringInputStream {
+ public:
+    // 'threads' <= 0 uses one worker per hardware thread
+    explicit BgzfStringInputStream(const std::string& file_path, int threads = 0,
+                                   IoBackend backend = IoBackend::Stdio,
+                                   bool verify_checksums = false);
+    ~BgzfStringInputStream();
+
+    // Checks whether the file starts with a BGZF block header
+    static bool IsBgzf(const std::string& file_path);
+
+    std::string ReadLine() override;
+    std::string_view ReadLineView() override;
+    int Peek() override;
+    void ResetFilePointer() override;
+    bool empty() const override;
+
+    int64_t position() const noexcept override;
+    int64_t uncompressed_position() const noexcept override;
+
+ private:
+    bool FillBuffer_() override;
+
+    std::unique_ptr<InputBackend> input_;
+    std::unique_ptr<BgzfReader> reader_;
+    bool eof_{false};
+    int64_t compressed_offset_{0};
+    // Uncompressed offset of the beginning of the block being parsed
+    int64_t uncompressed_offset_{0};
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_STREAMS_BGZFSTRINGINPUTSTREAM_HPP_
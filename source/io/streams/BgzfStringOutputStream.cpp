@@ -0,0 +1,241 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <exception>
+#include <zlib.h>
+
+#include "BgzfStringOutputStream.hpp"
+#include "../BgzfBlock.hpp"
+#include "../../log/Logger.hpp"
+#include "../../utils/MiscPrimitives.hpp"
+
+namespace gene {
+
+// Blocks in flight per worker, so that a slow block doesn't stall the others
+constexpr int kBlocksPerWorker = 4;
+
+BgzfStringOutputStream::BgzfStringOutputStream(const std::string& file_path, int threads,
+                                               IoBackend backend)
+: StringOutputStream(file_path, false, backend)
+{
+    thread_count_ = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    blocks_.resize(thread_count_ * kBlocksPerWorker);
+    for (auto& block : blocks_) {
+        block.data = std::make_unique<uint8_t[]>(kBgzfMaxBlockInputSize);
+        block.compressed = std::make_unique<uint8_t[]>(kBgzfMaxBlockSize);
+    }
+    blocks_.front().state = BlockState::Filling;
+
+    output_buffer_.reserve(kBufferSize + kBgzfMaxBlockSize);
+
+    for (int i = 0; i < thread_count_; ++i)
+        workers_.emplace_back(&BgzfStringOutputStream::WorkerLoop_, this);
+}
+
+BgzfStringOutputStream::~BgzfStringOutputStream()
+{
+    try {
+        Close();
+    } catch (const prim::UserVisibleError& error) {
+        PrintfLog("%s\n", error.what());
+    }
+}
+
+void BgzfStringOutputStream::ThrowIfFailed_()
+{
+    bool failed, write_failed;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        failed = failed_;
+        write_failed = write_failed_;
+    }
+    if (write_failed)
+        throw prim::UserVisibleError("Couldn't write '" + path_ + "'");
+    if (failed)
+        throw prim::UserVisibleError("Couldn't compress '" + path_ + "'");
+}
+
+void BgzfStringOutputStream::Write_(const char *data, size_t size)
+{
+    ThrowIfFailed_();
+    while (size > 0) {
+        Block& block = blocks_[next_submit_ % blocks_.size()];
+        size_t chunk = std::min<size_t>(size, kBgzfMaxBlockInputSize - block.size);
+        std::memcpy(block.data.get() + block.size, data, chunk);
+        block.size += chunk;
+        data += chunk;
+        size -= chunk;
+
+        if (block.size == kBgzfMaxBlockInputSize)
+            SubmitBlock_();
+    }
+}
+
+void BgzfStringOutputStream::SubmitBlock_()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    blocks_[next_submit_ % blocks_.size()].state = BlockState::Queued;
+    next_submit_++;
+    block_queued_.notify_one();
+
+    // Wait until the block we're going to fill next has been written out
+    Block& next = blocks_[next_submit_ % blocks_.size()];
+    block_written_.wait(lock, [&next] { return next.state == BlockState::Free; });
+    next.state = BlockState::Filling;
+    next.size = 0;
+}
+
+void BgzfStringOutputStream::WorkerLoop_()
+{
+    // A worker without a stream still takes its share of the blocks, so
+    // that the failure shows instead of the writer waiting for them forever
+    z_stream stream{};
+    const bool initialized =
+        deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+
+    while (true) {
+        Block *block;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            block_queued_.wait(lock, [this] { return stop_ || next_compress_ < next_submit_; });
+            if (next_compress_ >= next_submit_)
+                break;
+            block = &blocks_[next_compress_++ % blocks_.size()];
+        }
+
+        block->compressed_size = initialized ? BgzfBlock::Compress(stream,
+                                                                   block->data.get(),
+                                                                   block->size,
+                                                                   block->compressed.get())
+                                             : -1;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            block->state = BlockState::Compressed;
+        }
+        WriteCompressedBlocks_();
+    }
+    if (initialized)
+        deflateEnd(&stream);
+}
+
+void BgzfStringOutputStream::WriteCompressedBlocks_()
+{
+    // Whoever holds write_mutex_ writes out every block which is compressed
+    // and next in order. A worker finishing a block while another one is
+    // writing gets here afterwards and picks it up then.
+    std::lock_guard<std::mutex> write_lock(write_mutex_);
+    while (true) {
+        Block *block;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            block = &blocks_[next_write_ % blocks_.size()];
+            if (next_write_ >= next_submit_ || block->state != BlockState::Compressed)
+                return;
+        }
+
+        // Nothing more is written after a block that couldn't be
+        // compressed or written; Write_() and Close() report it
+        const bool compressed = block->compressed_size > 0;
+        if (compressed && !failed_ && !write_failed_) {
+            block_offsets_.push_back(compressed_length_);
+            compressed_length_ += block->compressed_size;
+            WriteOutput_(block->compressed.get(), block->compressed_size);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!compressed)
+                failed_ = true;
+            block->state = BlockState::Free;
+            next_write_++;
+        }
+        block_written_.notify_all();
+    }
+}
+
+void BgzfStringOutputStream::WriteOutput_(const uint8_t *data, size_t size)
+{
+    output_buffer_.insert(output_buffer_.end(), data, data + size);
+    if (output_buffer_.size() < kBufferSize)
+        return;
+
+    const bool written = output_->Write(output_buffer_.data(), output_buffer_.size());
+    output_buffer_.clear();
+    if (!written) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        write_failed_ = true;
+    }
+}
+
+uint64_t BgzfStringOutputStream::VirtualOffset(int64_t uncompressed_offset) const noexcept
+{
+    const size_t block = static_cast<size_t>(uncompressed_offset / kBgzfMaxBlockInputSize);
+    const uint64_t offset = static_cast<uint64_t>(uncompressed_offset % kBgzfMaxBlockInputSize);
+    // Past the end of a block is the start of the next one, as when reading
+    if (block >= block_offsets_.size() || uncompressed_offset >= position())
+        return static_cast<uint64_t>(compressed_length_) << 16;
+    return static_cast<uint64_t>(block_offsets_[block]) << 16 | offset;
+}
+
+void BgzfStringOutputStream::Close()
+{
+    if (closed_)
+        return;
+    closed_ = true;
+    // The workers are stopped even if the buffered output couldn't be
+    // passed on, and the error is thrown once they are
+    std::exception_ptr error;
+    try {
+        StopAsyncWrites_();
+        Flush();
+    } catch (...) {
+        error = std::current_exception();
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Block& last = blocks_[next_submit_ % blocks_.size()];
+        if (last.size > 0) {
+            last.state = BlockState::Queued;
+            next_submit_++;
+            block_queued_.notify_one();
+        } else {
+            last.state = BlockState::Free;
+        }
+        block_written_.wait(lock, [this] { return next_write_ == next_submit_; });
+        stop_ = true;
+    }
+    block_queued_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+    workers_.clear();
+
+    // Without the EOF marker readers can tell the file is incomplete
+    if (!failed_)
+        output_buffer_.insert(output_buffer_.end(), kBgzfEofBlock, kBgzfEofBlock + sizeof(kBgzfEofBlock));
+    if (!write_failed_ && !output_->Write(output_buffer_.data(), output_buffer_.size()))
+        write_failed_ = true;
+    output_buffer_.clear();
+    if (error)
+        std::rethrow_exception(error);
+    ThrowIfFailed_();
+    CloseOutput_();
+}
+
+}  // namespace gene
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_STREAMS_BGZFSTRINGOUTPUTSTREAM_HPP_
+#define LIBGENE_IO_STREAMS_BGZFSTRINGOUTPUTSTREAM_HPP_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "StringOutputStream.hpp"
+
+namespace gene {
+
+//
+// Output stream which writes BGZF, so the result can be read by any gzip
+// reader. Full blocks are deflated in parallel on worker threads and
+// written to the file in order by whichever worker completes the next one.
+//
+class BgzfStringOutputStream final : public StringOutputStream {
+ public:
+    // 'threads' <= 0 uses one worker per hardware thread
+    explicit BgzfStringOutputStream(const std::string& file_path, int threads = 0,
+                                    IoBackend backend = IoBackend::Stdio);
+    ~BgzfStringOutputStream();
+
+    // Compresses what's left, waits for all blocks to be written and appends
+    // the BGZF EOF marker. Called by the destructor if not called before.
+    // Throws prim::UserVisibleError, like writes, if a block couldn't be
+    // compressed or written out; the destructor only logs it.
+    void Close();
+
+    // BGZF virtual offset (compressed offset of the block << 16 | offset
+    // within it) of the byte written at 'uncompressed_offset', as counted
+    // by position(). Blocks are filled up to the same size, so this is known
+    // for every byte once Close() has returned.
+    uint64_t VirtualOffset(int64_t uncompressed_offset) const noexcept;
+
+ private:
+    enum class BlockState {
+        Free,
+        Filling,
+        Queued,
+        Compressed
+    };
+
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        std::unique_ptr<uint8_t[]> compressed;
+        int32_t size{0};
+        int32_t compressed_size{0};
+        BlockState state{BlockState::Free};
+    };
+
+    void Write_(const char *data, size_t size) override;
+    void SubmitBlock_();
+    void WorkerLoop_();
+    void WriteCompressedBlocks_();
+    void WriteOutput_(const uint8_t *data, size_t size);
+    void ThrowIfFailed_();
+
+    int thread_count_;
+    bool closed_{false};
+
+    // Blocks are numbered in output order; block 'n' lives in
+    // blocks_[n % size]. Block 'next_submit_' is being filled by the caller.
+    std::vector<Block> blocks_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::mutex write_mutex_;
+    std::condition_variable block_queued_;
+    std::condition_variable block_written_;
+    uint64_t next_submit_{0};
+    uint64_t next_compress_{0};
+    uint64_t next_write_{0};
+    bool stop_{false};
+    // Set once a block couldn't be compressed, or written out
+    bool failed_{false};
+    bool write_failed_{false};
+    // Where every block written so far starts in the file (under
+    // write_mutex_)
+    std::vector<int64_t> block_offsets_;
+    int64_t compressed_length_{0};
+
+    // Compressed blocks are much smaller than the chunks the base class
+    // writes, so they're collected here (under write_mutex_) first
+    std::vector<uint8_t> output_buffer_;
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_STREAMS_BGZFSTRINGOUTPUTSTREAM_HPP_
@@ -15,115 +15,232 @@
  */
 
 #include <algorithm>
+#include <cstring>
 #include <string>
 #include <stdexcept>
-#include <zlib.h>
 
 #include "CompressedStringInputStream.hpp"
+#include "../../log/Logger.hpp"
 #include "../../utils/MiscPrimitives.hpp"
 
 namespace gene {
 
-CompressedStringInputStream::CompressedStringInputStream(const std::string& file_path)
+CompressedStringInputStream::CompressedStringInputStream(const std::string& file_path,
+                                                         int read_ahead_buffers,
+                                                         int64_t read_ahead_buffer_size,
+                                                         int64_t index_span,
+                                                         IoBackend backend)
 : StringInputStream(file_path)
 {
-    file_ = fopen(path_.c_str(), "rt");
-    if (!file_)
-        throw prim::UserVisibleError("Couldn't open input compressed file");
+    index_ = GzipIndex::Load(path_);
+    if (index_)
+        index_saved_ = true;
+    else if (index_span > 0)
+        index_ = std::make_unique<GzipIndex>(index_span);
+
+    gzip_ = std::make_unique<GzipReader>(path_, index_.get(), backend);
+    length_ = gzip_->compressed_length();
+
+    if (read_ahead_buffers > 0 && read_ahead_buffer_size > 0) {
+        buffer_size_ = read_ahead_buffer_size;
+        buffers_.resize(read_ahead_buffers);
+        for (auto& buffer : buffers_)
+            buffer.data = std::make_unique<char[]>(buffer_size_);
+        StartReadAhead_();
+    }
+}
 
-    fseek(file_, 0L, SEEK_END);
-    length_ = ftell(file_);
-    fseek(file_, 0L, SEEK_SET);
-    fclose(file_);
-    file_ = nullptr;
+CompressedStringInputStream::~CompressedStringInputStream()
+{
+    StopReadAhead_();
+}
 
-    gzfile_ = gzopen(path_.c_str(), "rb");
-    if (!gzfile_)
-        throw prim::UserVisibleError("Couldn't open compressed file");
+void CompressedStringInputStream::SaveIndexIfBuilt_()
+{
+    if (!index_ || index_saved_ || !index_->complete())
+        return;
 
-    // Increase the default buffer size from 8192 bytes to 32K
-    gzbuffer(gzfile_, 32768);
+    index_saved_ = true;
+    if (!index_->Save(path_))
+        PrintfLog("Couldn't save index '%s'\n", GzipIndex::PathForFile(path_).c_str());
 }
 
-std::string CompressedStringInputStream::ReadLine()
+void CompressedStringInputStream::StartReadAhead_()
+{
+    produced_ = 0;
+    consumed_ = 0;
+    holding_ = false;
+    reader_done_ = false;
+    stop_ = false;
+    reader_ = std::thread(&CompressedStringInputStream::ReadAheadLoop_, this);
+}
+
+void CompressedStringInputStream::StopReadAhead_()
+{
+    if (!reader_.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    buffer_released_.notify_one();
+    reader_.join();
+}
+
+void CompressedStringInputStream::ReadAheadLoop_()
 {
-    std::string ret_str;
-    ret_str.reserve(100);
-    do {
-        if (pos_ < read_) {  // Buffer is not exhausted
-            char *record_start = buf_ + pos_;
-            char *p1 = (char *)memchr((void *)record_start, '\r', read_ - pos_);
-            char *p2 = (char *)memchr((void *)record_start, '\n', read_ - pos_);
-            if (p1 || p2) {
-                char *p;
-                if (p1 && p2)
-                    p = std::min(p1, p2);
-                else if (p1)
-                    p = p1;
-                else
-                    p = p2;
-
-                int64_t length = std::distance(record_start, p);
-                if (length == 0 && ret_str.empty()) {
-                    // This check was added to cope with problem arising with \r\n split over
-                    // several fread's (we would skip \r, but leave \n on the next read
-                    // resulting in empty line).
-                    // Genuinely empty lines (with only newline char) will be skipped,
-                    // which I think is a reasonable behaviour.
-                    while (pos_ < read_ && (buf_[pos_] == '\r' || buf_[pos_] == '\n'))
-                        pos_++;
-                    continue;
-                }
-                std::string ret(record_start, length);
-                pos_ += length;
-
-                // Skip newline characters (if exist)
-                while (pos_ < read_ && (buf_[pos_] == '\r' || buf_[pos_] == '\n'))
-                    pos_++;
-
-                if (ret_str.empty())
-                    ret_str = std::move(ret);
-                else
-                    ret_str.append(ret);
-
-                return ret_str;
-            } else {
-                ret_str.append(buf_ + pos_, read_ - pos_);
-            }
+    const uint64_t buffer_count = buffers_.size();
+    while (true) {
+        uint64_t index;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            buffer_released_.wait(lock, [this, buffer_count] {
+                return stop_ || produced_ - consumed_ < buffer_count;
+            });
+            if (stop_)
+                return;
+            index = produced_ % buffer_count;
         }
-        // Read more data
-        pos_ = 0;
-        read_ = gzread(gzfile_, buf_, BUFSIZ);
-    } while (read_);
-    return ret_str;
+
+        // Only this thread touches gzip_ and the free buffer while the
+        // read-ahead is running, so inflate outside of the lock.
+        Buffer& buffer = buffers_[index];
+        buffer.uncompressed_offset = gzip_->uncompressed_offset();
+        int64_t read = gzip_->Read(buffer.data.get(), buffer_size_);
+        buffer.size = read;
+        buffer.compressed_offset = gzip_->compressed_offset();
+        if (read <= 0)
+            SaveIndexIfBuilt_();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (read <= 0)
+                reader_done_ = true;
+            else
+                produced_++;
+        }
+        buffer_filled_.notify_one();
+        if (read <= 0)
+            return;
+    }
 }
 
-int CompressedStringInputStream::Peek()
+bool CompressedStringInputStream::FillBuffer_()
 {
-    if (pos_ < read_) {
-        // Have something in buffer
-        return buf_[pos_];
-    } else {
-        int c = gzgetc(gzfile_);
-        gzungetc(c, gzfile_);
-        return c;
+    buffer_offset_ += read_;
+    pos_ = 0;
+    read_ = 0;
+
+    if (eof_)
+        return false;
+
+    if (buffers_.empty()) {
+        buffer_offset_ = gzip_->uncompressed_offset();
+        const int64_t limit = std::clamp<int64_t>(end_ - buffer_offset_, 0, BUFSIZ);
+        read_ = std::max<int64_t>(gzip_->Read(buf_, limit), 0);
+        data_ = buf_;
+        eof_ = (read_ == 0);
+        if (eof_)
+            SaveIndexIfBuilt_();
+        return !eof_;
     }
+
+    // Restarted lazily after a seek, so that seeking repeatedly doesn't
+    // inflate buffers nobody reads
+    if (!reader_.joinable())
+        StartReadAhead_();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (holding_) {
+        consumed_++;
+        holding_ = false;
+        buffer_released_.notify_one();
+    }
+    buffer_filled_.wait(lock, [this] { return produced_ > consumed_ || reader_done_; });
+    if (produced_ == consumed_) {
+        eof_ = true;
+        return false;
+    }
+
+    const Buffer& buffer = buffers_[consumed_ % buffers_.size()];
+    holding_ = true;
+    data_ = buffer.data.get();
+    read_ = std::clamp<int64_t>(end_ - buffer.uncompressed_offset, 0, buffer.size);
+    compressed_offset_ = buffer.compressed_offset;
+    buffer_offset_ = buffer.uncompressed_offset;
+    eof_ = (read_ == 0);
+    return !eof_;
+}
+
+std::string_view CompressedStringInputStream::ReadLineView()
+{
+    return ReadBufferedLineView_();
+}
+
+std::string CompressedStringInputStream::ReadLine()
+{
+    return std::string(ReadLineView());
+}
+
+int CompressedStringInputStream::Peek()
+{
+    if (pos_ >= read_ && !FillBuffer_())
+        return EOF;
+
+    return data_[pos_];
 }
 
 void CompressedStringInputStream::ResetFilePointer()
 {
-    gzseek(gzfile_, 0L, SEEK_SET);
+    SeekUncompressed(begin_);
+}
+
+bool CompressedStringInputStream::SeekUncompressed(int64_t offset)
+{
+    StopReadAhead_();
+    bool found = gzip_->Seek(offset);
     pos_ = 0;
     read_ = 0;
-    memset(buf_, 0, BUFSIZ);
+    eof_ = !found;
+    compressed_offset_ = gzip_->compressed_offset();
+    buffer_offset_ = gzip_->uncompressed_offset();
+    return found;
 }
 
-int64_t CompressedStringInputStream::position() const noexcept
+int64_t CompressedStringInputStream::uncompressed_position() const noexcept
 {
-    if (gzfile_)
-        return gzoffset(gzfile_);
-    else
+    return buffer_offset_ + pos_;
+}
+
+int64_t CompressedStringInputStream::uncompressed_length() const noexcept
+{
+    if (!index_ || !index_->complete())
         return -1;
+    return index_->uncompressed_size();
+}
+
+bool CompressedStringInputStream::Restrict(int64_t begin, int64_t end)
+{
+    begin_ = begin;
+    end_ = end;
+    SeekUncompressed(begin);
+    return true;
+}
+
+bool CompressedStringInputStream::empty() const
+{
+    return eof_ && pos_ >= read_;
+}
+
+int64_t CompressedStringInputStream::position() const noexcept
+{
+    // gzip_ can't be asked while the read-ahead thread is inflating, so
+    // report the offset the current buffer was read up to instead
+    if (!buffers_.empty())
+        return compressed_offset_;
+
+    return gzip_->compressed_offset();
 }
 
 }  // namespace gene
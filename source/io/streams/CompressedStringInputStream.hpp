@@ -18,25 +18,99 @@
 #define CompressedStringInputStream_hpp
 
 #include <string>
-#include <zlib.h>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "StringInputStream.hpp"
+#include "../GzipIndex.hpp"
+#include "../GzipReader.hpp"
+#include "../backends/IoBackend.hpp"
 
 namespace gene {
 
-class CompressedStringInputStream final : public StringInputStream {    
+//
+// With 'read_ahead_buffers' > 0 the file is inflated on a dedicated thread
+// into a ring of 'read_ahead_buffers' buffers of 'read_ahead_buffer_size'
+// bytes each, while the caller parses lines out of the previously filled one.
+// With 0 buffers, the file is inflated inline on the caller's thread.
+//
+// An up to date <file>.gzidx index next to the file is always used for
+// seeking. With 'index_span' > 0 and no such index, one is built with a
+// checkpoint every 'index_span' bytes and saved once the file has been read
+// through to the end.
+//
+class CompressedStringInputStream final : public StringInputStream {
  public:
-    explicit CompressedStringInputStream(const std::string& file_path);
-    ~CompressedStringInputStream() = default;
+    static constexpr int kDefaultReadAheadBuffers = 4;
+    static constexpr int64_t kDefaultReadAheadBufferSize = 1 << 20;
+
+    explicit CompressedStringInputStream(const std::string& file_path,
+                                         int read_ahead_buffers = kDefaultReadAheadBuffers,
+                                         int64_t read_ahead_buffer_size = kDefaultReadAheadBufferSize,
+                                         int64_t index_span = 0,
+                                         IoBackend backend = IoBackend::Stdio);
+    ~CompressedStringInputStream();
 
     std::string ReadLine() override;
+    std::string_view ReadLineView() override;
     int Peek() override;
     void ResetFilePointer() override;
+    bool empty() const override;
 
     int64_t position() const noexcept override;
 
+    int64_t uncompressed_position() const noexcept override;
+
+    // Only known once the file has been indexed
+    int64_t uncompressed_length() const noexcept override;
+    bool Restrict(int64_t begin, int64_t end) override;
+
+    // Continues reading at the given uncompressed offset, which is cheap with
+    // an index. Returns false (leaving the stream empty) if the file is
+    // shorter than that.
+    bool SeekUncompressed(int64_t offset);
+
  private:
-    gzFile gzfile_;
+    struct Buffer {
+        std::unique_ptr<char[]> data;
+        int64_t size{0};
+        int64_t compressed_offset{0};
+        int64_t uncompressed_offset{0};
+    };
+
+    bool FillBuffer_() override;
+    void StartReadAhead_();
+    void StopReadAhead_();
+    void ReadAheadLoop_();
+    void SaveIndexIfBuilt_();
+
+    std::unique_ptr<GzipIndex> index_;
+    bool index_saved_{false};
+    std::unique_ptr<GzipReader> gzip_;
+    bool eof_{false};
+    // Uncompressed offset of the beginning of the buffer being parsed
+    int64_t buffer_offset_{0};
+    int64_t begin_{0};
+    int64_t end_{kEndOfStream};
+
+    // Read-ahead state. 'produced_' and 'consumed_' only ever grow; the buffer
+    // with index 'consumed_' is the one being parsed while 'holding_' is set.
+    std::vector<Buffer> buffers_;
+    int64_t buffer_size_{0};
+    std::thread reader_;
+    std::mutex mutex_;
+    std::condition_variable buffer_filled_;
+    std::condition_variable buffer_released_;
+    uint64_t produced_{0};
+    uint64_t consumed_{0};
+    bool holding_{false};
+    bool reader_done_{false};
+    bool stop_{false};
+    int64_t compressed_offset_{0};
 };
 
 }  // namespace gene
@@ -0,0 +1,152 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef _MSC_VER
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "MappedStringInputStream.hpp"
+#include "../../utils/MiscPrimitives.hpp"
+
+namespace gene {
+
+MappedStringInputStream::MappedStringInputStream(const std::string& file_path)
+: StringInputStream(file_path)
+{
+    if (fd_ = open(path_.c_str(), O_RDONLY); fd_ < 0)
+        throw prim::UserVisibleError("Couldn't open input file");
+
+    struct stat st;
+    if (fstat(fd_, &st) != 0) {
+        close(fd_);
+        throw prim::UserVisibleError("Couldn't open input file");
+    }
+    length_ = st.st_size;
+
+    void *mapping = mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd_);
+        throw prim::UserVisibleError("Couldn't map input file into memory");
+    }
+    data_ = static_cast<const char *>(mapping);
+    end_ = length_;
+
+    // Records are consumed front to back: let the kernel read ahead
+    // aggressively and drop pages behind the cursor early.
+    madvise(mapping, length_, MADV_SEQUENTIAL);
+}
+
+MappedStringInputStream::~MappedStringInputStream()
+{
+    if (data_)
+        munmap(const_cast<char *>(data_), length_);
+    if (fd_ >= 0)
+        close(fd_);
+}
+
+bool MappedStringInputStream::IsMappable(const std::string& file_path)
+{
+    struct stat st;
+    if (stat(file_path.c_str(), &st) != 0)
+        return false;
+
+    return S_ISREG(st.st_mode) &&
+           st.st_size > 0 &&
+           static_cast<uint64_t>(st.st_size) <= SIZE_MAX;
+}
+
+std::string_view MappedStringInputStream::ReadLineView()
+{
+    // Newline characters are skipped before the line rather than after it, so
+    // that '\r\n' pairs and empty lines are dropped just like in
+    // PlainStringInputStream.
+    while (pos_ < end_ && (data_[pos_] == '\r' || data_[pos_] == '\n'))
+        pos_++;
+
+    if (pos_ >= end_)
+        return {};
+
+    const char *line_start = data_ + pos_;
+    const size_t remaining = end_ - pos_;
+
+    // Only look for '\r' in front of the '\n' found, otherwise a file without
+    // any '\r' would be scanned to the end for every line.
+    auto *newline = static_cast<const char *>(memchr(line_start, '\n', remaining));
+    size_t line_length = newline ? newline - line_start : remaining;
+    if (auto *cr = static_cast<const char *>(memchr(line_start, '\r', line_length)))
+        line_length = cr - line_start;
+
+    pos_ += line_length;
+
+    while (pos_ < end_ && (data_[pos_] == '\r' || data_[pos_] == '\n'))
+        pos_++;
+
+    return {line_start, line_length};
+}
+
+std::string MappedStringInputStream::ReadLine()
+{
+    return std::string(ReadLineView());
+}
+
+int MappedStringInputStream::Peek()
+{
+    if (pos_ < end_)
+        return data_[pos_];
+    else
+        return EOF;
+}
+
+void MappedStringInputStream::ResetFilePointer()
+{
+    pos_ = begin_;
+}
+
+bool MappedStringInputStream::empty() const
+{
+    return pos_ >= end_;
+}
+
+int64_t MappedStringInputStream::position() const noexcept
+{
+    return pos_;
+}
+
+int64_t MappedStringInputStream::uncompressed_length() const noexcept
+{
+    return length_;
+}
+
+bool MappedStringInputStream::Restrict(int64_t begin, int64_t end)
+{
+    begin_ = std::clamp<int64_t>(begin, 0, length_);
+    end_ = std::clamp<int64_t>(end, begin_, length_);
+    pos_ = begin_;
+    return true;
+}
+
+}  // namespace gene
+
+#endif  // _MSC_VER
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_STREAMS_MAPPEDSTRINGINPUTSTREAM_HPP_
+#define LIBGENE_IO_STREAMS_MAPPEDSTRINGINPUTSTREAM_HPP_
+
+#include <string>
+#include <string_view>
+
+#include "StringInputStream.hpp"
+
+namespace gene {
+
+//
+// Input stream over a read-only memory mapping of the whole file. Lines
+// returned by ReadLineView() point straight into the mapping, so nothing is
+// copied unless the caller asks for an owning std::string.
+//
+class MappedStringInputStream final : public StringInputStream {
+ public:
+    explicit MappedStringInputStream(const std::string& file_path);
+    ~MappedStringInputStream();
+
+    // Only non-empty regular files can be mapped (not pipes or devices)
+    static bool IsMappable(const std::string& file_path);
+
+    std::string ReadLine() override;
+    std::string_view ReadLineView() override;
+    int Peek() override;
+    void ResetFilePointer() override;
+    bool empty() const override;
+
+    int64_t position() const noexcept override;
+    int64_t uncompressed_length() const noexcept override;
+    bool Restrict(int64_t begin, int64_t end) override;
+
+ private:
+    int fd_{-1};
+    const char *data_{nullptr};
+    int64_t begin_{0};
+    int64_t end_{0};
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_STREAMS_MAPPEDSTRINGINPUTSTREAM_HPP_
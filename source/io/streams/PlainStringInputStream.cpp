@@ -16,100 +16,98 @@
 
 #include <algorithm>
 #include <string>
-#include <stdexcept>
 
 #include "PlainStringInputStream.hpp"
-#include "StringStream.hpp"
-#include "../../utils/MiscPrimitives.hpp"
 
 namespace gene {
 
-PlainStringInputStream::PlainStringInputStream(const std::string& file_path)
+PlainStringInputStream::PlainStringInputStream(const std::string& file_path, IoBackend backend)
 : StringInputStream(file_path)
+, input_(InputBackend::Open(file_path, backend))
+, buffer_(std::make_unique<char[]>(kBufferSize))
 {
-    if (file_ = fopen(path_.c_str(), "rt"); file_ == nullptr)
-        throw prim::UserVisibleError("Couldn't open input file");
+    length_ = input_->length();
+    data_ = buffer_.get();
+}
 
-    fseek(file_, 0L, SEEK_END);
-    length_ = ftell(file_);
-    fseek(file_, 0L, SEEK_SET);
+int64_t PlainStringInputStream::ReadLimit_() const
+{
+    if (end_ == kEndOfStream)
+        return kBufferSize;
+    return std::clamp<int64_t>(end_ - input_->position(), 0, kBufferSize);
 }
 
-int PlainStringInputStream::Peek()
+bool PlainStringInputStream::FillBuffer_()
 {
-    if (pos_ < read_) {
-        // Have something in buffer
-        return buf_[pos_];
-    } else {
-        int c = fgetc(file_);
-        ungetc(c, file_);
-        return c;
-    }
+    pos_ = 0;
+    read_ = 0;
+    if (eof_)
+        return false;
+
+    // Backends only return less than asked for at the end of the file
+    const int64_t limit = ReadLimit_();
+    read_ = std::max<int64_t>(input_->Read(buffer_.get(), limit), 0);
+    eof_ = read_ < limit || limit == 0;
+    return read_ > 0;
+}
+
+std::string_view PlainStringInputStream::ReadLineView()
+{
+    return ReadBufferedLineView_();
 }
 
 std::string PlainStringInputStream::ReadLine()
 {
-    std::string ret_str;
-    ret_str.reserve(100);
-    do {
-        if (pos_ < read_) {  // Have something in buf_
-            char *record_start = buf_ + pos_;
-            char *p1 = (char *)memchr((void *)record_start, '\r', read_ - pos_);
-            char *p2 = (char *)memchr((void *)record_start, '\n', read_ - pos_);
-            if (p1 || p2) {
-                char *p;
-                if (p1 && p2)
-                    p = std::min(p1, p2);
-                else if (p1)
-                    p = p1;
-                else
-                    p = p2;
-
-                int64_t length = std::distance(record_start, p);
-                if (length == 0 && ret_str.empty()) {
-                    // This check was added to cope with problem arising with \r\n split over
-                    // several fread's (we would skip \r, but leave \n on the next read
-                    // resulting in empty line).
-                    // Genuinely empty lines (with only newline char) will be skipped,
-                    // which I think is a reasonable behaviour.
-                    while (pos_ < read_ && (buf_[pos_] == '\r' || buf_[pos_] == '\n'))
-                        pos_++;
-                    continue;
-                }
-                std::string ret(record_start, length);
-                pos_ += length;
-
-                // Skip newline characters (if exist)
-                while (pos_ < read_ && (buf_[pos_] == '\r' || buf_[pos_] == '\n'))
-                    pos_++;
-
-                if (ret_str.empty())
-                    ret_str = std::move(ret);
-                else
-                    ret_str.append(ret);
-
-                return ret_str;
-            } else
-                ret_str.append(buf_ + pos_, read_ - pos_);
-        }
-        // Read more data
-        pos_ = 0;
-        read_ = fread(buf_, 1, BUFSIZ, file_);
-    } while (read_);
-    return ret_str;
+    return std::string(ReadLineView());
+}
+
+int PlainStringInputStream::Peek()
+{
+    if (pos_ >= read_ && !FillBuffer_())
+        return EOF;
+
+    return data_[pos_];
 }
 
 void PlainStringInputStream::ResetFilePointer()
 {
-    fseek(file_, 0L, SEEK_SET);
+    input_->Seek(begin_);
+    pos_ = 0;
+    read_ = 0;
+    eof_ = false;
+}
+
+bool PlainStringInputStream::empty() const
+{
+    return pos_ == read_ && (eof_ || ReadLimit_() == 0);
+}
+
+int64_t PlainStringInputStream::position() const noexcept
+{
+    return input_->position() - read_ + pos_;
+}
+
+int64_t PlainStringInputStream::uncompressed_length() const noexcept
+{
+    return length_;
+}
+
+bool PlainStringInputStream::Restrict(int64_t begin, int64_t end)
+{
+    if (!input_->Seek(begin))
+        return false;
+
+    begin_ = begin;
+    end_ = end;
     pos_ = 0;
     read_ = 0;
-    memset(buf_, '\0', BUFSIZ);
+    eof_ = false;
+    return true;
 }
 
 PlainStringInputStream::operator bool() const
 {
-    return (file_ != nullptr) && (ftell(file_) < length_);
+    return position() < length_;
 }
 
 }  // namespace gene
@@ -18,20 +18,44 @@
 #define PlainStringInputStream_hpp
 
 #include <string>
+#include <string_view>
+#include <memory>
 
 #include "StringInputStream.hpp"
+#include "../backends/IoBackend.hpp"
 
 namespace gene {
 
 class PlainStringInputStream final : public StringInputStream {
  public:
-    explicit PlainStringInputStream(const std::string& file_path);
+    explicit PlainStringInputStream(const std::string& file_path,
+                                    IoBackend backend = IoBackend::Stdio);
     ~PlainStringInputStream() = default;
 
     std::string ReadLine() override;
+    std::string_view ReadLineView() override;
     int Peek() override;
     void ResetFilePointer() override;
+    bool empty() const override;
     explicit operator bool() const;
+
+    int64_t position() const noexcept override;
+    int64_t uncompressed_length() const noexcept override;
+    bool Restrict(int64_t begin, int64_t end) override;
+
+ private:
+    static constexpr int64_t kBufferSize = 1 << 20;
+
+    bool FillBuffer_() override;
+
+    // Number of bytes the next read may return without crossing end_
+    int64_t ReadLimit_() const;
+
+    std::unique_ptr<InputBackend> input_;
+    std::unique_ptr<char[]> buffer_;
+    bool eof_{false};
+    int64_t begin_{0};
+    int64_t end_{kEndOfStream};
 };
 
 }  // namespace gene
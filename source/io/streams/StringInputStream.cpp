@@ -14,30 +14,169 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cstring>
 #include <memory>
 #include <cassert>
 
 #include "StringInputStream.hpp"
 #include "CompressedStringInputStream.hpp"
+#include "BgzfStringInputStream.hpp"
 #include "PlainStringInputStream.hpp"
+#include "MappedStringInputStream.hpp"
+#include "ZstdStringInputStream.hpp"
 #include "../../utils/StringUtils.hpp"
+#include "../../flags/CommandLineFlags.hpp"
+#include "../../def/Flags.hpp"
 
 namespace gene {
 
+// .bgz is what bgzip and the BGZF writer call their output
+static bool HasGzipExtension(const std::string& file_path)
+{
+    return utils::HasExtension(file_path, "gz") || utils::HasExtension(file_path, "bgz");
+}
+
 std::unique_ptr<StringInputStream>
 StringInputStream::StreamWithFileName(const std::string& file_path)
 {
-    if (utils::HasExtension(file_path, "gz"))
+    if (HasGzipExtension(file_path) && BgzfStringInputStream::IsBgzf(file_path))
+        return std::make_unique<BgzfStringInputStream>(file_path);
+    else if (HasGzipExtension(file_path))
         return std::make_unique<CompressedStringInputStream>(file_path);
+    else if (utils::HasExtension(file_path, "zst") && ZstdStringInputStream::IsZstd(file_path))
+        return std::make_unique<ZstdStringInputStream>(file_path);
+#ifndef _MSC_VER
+    else if (MappedStringInputStream::IsMappable(file_path))
+        return std::make_unique<MappedStringInputStream>(file_path);
+#endif  // _MSC_VER
     else
         return std::make_unique<PlainStringInputStream>(file_path);
 }
 
+std::unique_ptr<StringInputStream>
+StringInputStream::StreamWithFileName(const std::string& file_path,
+                                      const std::unique_ptr<CommandLineFlags>& flags)
+{
+    if (!flags->SettingExists(Flags::kIoBackend) && !HasGzipExtension(file_path))
+        return StreamWithFileName(file_path);
+
+    const IoBackend backend = IoBackendFromFlags(flags);
+    if (utils::HasExtension(file_path, "zst") && ZstdStringInputStream::IsZstd(file_path))
+        return std::make_unique<ZstdStringInputStream>(file_path, backend);
+    if (!HasGzipExtension(file_path)) {
+#ifndef _MSC_VER
+        if (backend == IoBackend::Mmap && MappedStringInputStream::IsMappable(file_path))
+            return std::make_unique<MappedStringInputStream>(file_path);
+#endif  // _MSC_VER
+        return std::make_unique<PlainStringInputStream>(file_path, backend);
+    }
+
+    if (BgzfStringInputStream::IsBgzf(file_path))
+        return std::make_unique<BgzfStringInputStream>(file_path,
+                                                       flags->GetIntSetting(Flags::kDecompressionThreads),
+                                                       backend,
+                                                       flags->SettingExists(Flags::kVerifyChecksums));
+
+    int buffers = CompressedStringInputStream::kDefaultReadAheadBuffers;
+    int64_t buffer_size = CompressedStringInputStream::kDefaultReadAheadBufferSize;
+    if (flags->SettingExists(Flags::kReadAheadBuffers))
+        buffers = flags->GetIntSetting(Flags::kReadAheadBuffers);
+    if (flags->SettingExists(Flags::kReadAheadBufferSize))
+        buffer_size = static_cast<int64_t>(flags->GetIntSetting(Flags::kReadAheadBufferSize)) * 1024;
+
+    int64_t index_span = 0;
+    if (flags->SettingExists(Flags::kGzipIndexSpan))
+        index_span = static_cast<int64_t>(flags->GetIntSetting(Flags::kGzipIndexSpan)) << 20;
+
+    return std::make_unique<CompressedStringInputStream>(file_path, buffers, buffer_size, index_span,
+                                                         backend);
+}
+
 StringInputStream::StringInputStream(const std::string& file_path)
 : StringStream(file_path)
 {
 }
 
+std::string_view StringInputStream::ReadLineView()
+{
+    line_ = ReadLine();
+    return line_;
+}
+
+bool StringInputStream::FillBuffer_()
+{
+    return false;
+}
+
+std::string_view StringInputStream::ReadBufferedLineView_()
+{
+    bool spans_buffers = false;
+    line_.clear();
+    while (true) {
+        if (pos_ < read_) {  // Buffer is not exhausted
+            const char *record_start = data_ + pos_;
+            // Only look for '\r' in front of the '\n' found, otherwise a large
+            // buffer without any '\r' would be scanned to the end for every line
+            auto *p2 = static_cast<const char *>(memchr(record_start, '\n', read_ - pos_));
+            auto *p1 = static_cast<const char *>(memchr(record_start, '\r',
+                                                        p2 ? p2 - record_start : read_ - pos_));
+            if (p1 || p2) {
+                const char *p;
+                if (p1 && p2)
+                    p = std::min(p1, p2);
+                else if (p1)
+                    p = p1;
+                else
+                    p = p2;
+
+                int64_t length = std::distance(record_start, p);
+                if (length == 0 && !spans_buffers) {
+                    // This check was added to cope with problem arising with \r\n split over
+                    // several fread's (we would skip \r, but leave \n on the next read
+                    // resulting in empty line).
+                    // Genuinely empty lines (with only newline char) will be skipped,
+                    // which I think is a reasonable behaviour.
+                    while (pos_ < read_ && (data_[pos_] == '\r' || data_[pos_] == '\n'))
+                        pos_++;
+                    continue;
+                }
+                pos_ += length;
+
+                // Skip newline characters (if exist)
+                while (pos_ < read_ && (data_[pos_] == '\r' || data_[pos_] == '\n'))
+                    pos_++;
+
+                if (!spans_buffers)
+                    return {record_start, static_cast<size_t>(length)};
+
+                line_.append(record_start, length);
+                return line_;
+            } else {
+                line_.append(record_start, read_ - pos_);
+                spans_buffers = true;
+            }
+        }
+        if (!FillBuffer_())
+            return line_;
+    }
+}
+
+int64_t StringInputStream::uncompressed_position() const noexcept
+{
+    return position();
+}
+
+int64_t StringInputStream::uncompressed_length() const noexcept
+{
+    return -1;
+}
+
+bool StringInputStream::Restrict(int64_t, int64_t)
+{
+    return false;
+}
+
 bool StringInputStream::empty() const
 {
     // The second condition checks if we've reached the end of file, but still
@@ -18,22 +18,65 @@
 #define LIBGENE_IO_STREAMS_STRINGINPUTSTREAM_HPP_
 
 #include <string>
+#include <string_view>
 #include <memory>
+#include <cstdint>
 
 #include "StringStream.hpp"
 
 namespace gene {
 
+class CommandLineFlags;
+
 class StringInputStream : public StringStream {
+ protected:
+    // Backing storage for ReadLineView() in streams that can't hand out
+    // views into their own buffers
+    std::string line_;
+
+    // Buffer being parsed by ReadBufferedLineView_(), 'read_' bytes long
+    const char *data_{buf_};
+
+    // Replaces an exhausted buffer with the next one, resetting data_, read_
+    // and pos_. Returns false at the end of the stream.
+    virtual bool FillBuffer_();
+
+    // ReadLineView() for streams which are read via FillBuffer_(). Lines
+    // which span two buffers are collected in line_.
+    std::string_view ReadBufferedLineView_();
+
  public:
     static std::unique_ptr<StringInputStream>
     StreamWithFileName(const std::string& file_path);
+    static std::unique_ptr<StringInputStream>
+    StreamWithFileName(const std::string& file_path,
+                       const std::unique_ptr<CommandLineFlags>& flags);
 
     explicit StringInputStream(const std::string& file_path);
     virtual std::string ReadLine() = 0;
+
+    // Same as ReadLine(), but the returned view is only valid until the next
+    // read from the stream. Copy it if the line has to outlive that.
+    virtual std::string_view ReadLineView();
+
     virtual int Peek() = 0;
     virtual void ResetFilePointer() = 0;
-    bool empty() const;
+    virtual bool empty() const;
+
+    // Passed as 'end' to Restrict() to read up to the end of the file
+    static constexpr int64_t kEndOfStream = INT64_MAX;
+
+    // Offset of the next byte read in the uncompressed data
+    virtual int64_t uncompressed_position() const noexcept;
+
+    // Size of the uncompressed data, or -1 if it isn't known without reading
+    // the whole stream or Restrict() isn't supported
+    virtual int64_t uncompressed_length() const noexcept;
+
+    // Continues reading at uncompressed offset 'begin' and stops at 'end'
+    // (exclusive). ResetFilePointer() goes back to 'begin' afterwards. Returns
+    // false if the stream can't seek, in which case nothing changes.
+    virtual bool Restrict(int64_t begin, int64_t end);
 };
 
 }  // namespace gene
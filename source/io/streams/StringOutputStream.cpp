@@ -16,62 +16,299 @@
 
 #include "StringOutputStream.hpp"
 
+#include <algorithm>
+#include <charconv>
+#include <cstring>
 #include <stdexcept>
 #include <cstdio>
 
+#include "BgzfStringOutputStream.hpp"
+#include "ZstdStringOutputStream.hpp"
 #include "../../utils/MiscPrimitives.hpp"
+#include "../../utils/StringUtils.hpp"
+#include "../../flags/CommandLineFlags.hpp"
+#include "../../def/Flags.hpp"
+#include "../../log/Logger.hpp"
 
 namespace gene {
 
 static const char kNewlineSequence[] = "\n";
 
-StringOutputStream::StringOutputStream(const std::string& fileName)
-: StringStream(fileName)
+constexpr int kDefaultAsyncBuffers = 4;
+
+StringOutputStream::StringOutputStream(const std::string& fileName, IoBackend backend)
+: StringOutputStream(fileName, true, backend)
 {
-    file_ = fopen(fileName.c_str(), "wt");
-    if (file_ == nullptr)
-        throw prim::UserVisibleError("Couldn't open '" + fileName + "' for writing.\n\nCheck folder write permissions.");
+}
 
+StringOutputStream::StringOutputStream(const std::string& fileName, bool text, IoBackend backend)
+: StringStream(fileName)
+, output_(OutputBackend::Open(fileName, backend, text))
+{
+    buffer_ = std::make_unique<char[]>(kBufferSize);
     length_ = 0;
 }
 
 std::unique_ptr<StringOutputStream>
 StringOutputStream::StreamWithFileName(const std::string& fileName)
 {
-    return std::make_unique<StringOutputStream>(fileName);
+    if (utils::HasExtension(fileName, "gz") || utils::HasExtension(fileName, "bgz") ||
+        utils::HasExtension(fileName, "bam"))
+        return std::make_unique<BgzfStringOutputStream>(fileName);
+    else if (utils::HasExtension(fileName, "zst"))
+        return std::make_unique<ZstdStringOutputStream>(fileName);
+    else
+        return std::make_unique<StringOutputStream>(fileName);
+}
+
+std::unique_ptr<StringOutputStream>
+StringOutputStream::StreamWithFileName(const std::string& fileName,
+                                       const std::unique_ptr<CommandLineFlags>& flags)
+{
+    const IoBackend backend = IoBackendFromFlags(flags);
+    std::unique_ptr<StringOutputStream> stream;
+    if (utils::HasExtension(fileName, "gz") || utils::HasExtension(fileName, "bgz") ||
+        utils::HasExtension(fileName, "bam"))
+        stream = std::make_unique<BgzfStringOutputStream>(fileName,
+                                                          flags->GetIntSetting(Flags::kCompressionThreads),
+                                                          backend);
+    else if (utils::HasExtension(fileName, "zst"))
+        stream = std::make_unique<ZstdStringOutputStream>(fileName,
+                                                          flags->GetIntSetting(Flags::kCompressionThreads),
+                                                          0, backend);
+    else
+        stream = std::make_unique<StringOutputStream>(fileName, backend);
+
+    if (flags->SettingExists(Flags::kAsyncOutput)) {
+        int buffers = flags->GetIntSetting(Flags::kAsyncOutput);
+        stream->EnableAsyncWrites(buffers > 0 ? buffers : kDefaultAsyncBuffers);
+    }
+    return stream;
+}
+
+StringOutputStream::~StringOutputStream()
+{
+    // Subclasses with their own Write_() flush before they're torn down
+    try {
+        StopAsyncWrites_();
+        Flush();
+        CloseOutput_();
+    } catch (const prim::UserVisibleError& error) {
+        PrintfLog("%s\n", error.what());
+    }
+    output_->Close();
+}
+
+void StringOutputStream::Write_(const char *data, size_t size)
+{
+    WriteToOutput_(data, size);
+}
+
+void StringOutputStream::WriteToOutput_(const void *data, size_t size)
+{
+    if (!output_->Write(data, static_cast<int64_t>(size)))
+        throw prim::UserVisibleError("Couldn't write '" + path_ + "'");
+}
+
+void StringOutputStream::CloseOutput_()
+{
+    if (output_closed_)
+        return;
+    output_closed_ = true;
+    if (!output_->Close())
+        throw prim::UserVisibleError("Couldn't write '" + path_ + "'");
+}
+
+void StringOutputStream::EnableAsyncWrites(int buffers)
+{
+    if (writer_.joinable())
+        return;
+
+    // One buffer is always the one being filled
+    free_buffers_.clear();
+    for (int i = 1; i < std::max(buffers, 2); ++i)
+        free_buffers_.push_back(std::make_unique<char[]>(kBufferSize));
+
+    stop_writer_ = false;
+    writer_ = std::thread(&StringOutputStream::WriterLoop_, this);
+}
+
+void StringOutputStream::StopAsyncWrites_()
+{
+    if (!writer_.joinable())
+        return;
+
+    // The writer is stopped even if the last buffer couldn't be queued
+    std::exception_ptr error;
+    try {
+        Flush();
+    } catch (...) {
+        error = std::current_exception();
+    }
+    {
+        std::lock_guard<std::mutex> lock(async_mutex_);
+        stop_writer_ = true;
+    }
+    buffer_queued_.notify_one();
+    writer_.join();
+    if (error)
+        std::rethrow_exception(error);
+    ThrowWriterError_();
+}
+
+void StringOutputStream::ThrowWriterError_()
+{
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(async_mutex_);
+        std::swap(error, writer_error_);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+void StringOutputStream::WriterLoop_()
+{
+    while (true) {
+        PendingBuffer pending;
+        {
+            std::unique_lock<std::mutex> lock(async_mutex_);
+            buffer_queued_.wait(lock, [this] { return stop_writer_ || !pending_buffers_.empty(); });
+            if (pending_buffers_.empty())
+                return;
+            pending = std::move(pending_buffers_.front());
+            pending_buffers_.pop_front();
+        }
+
+        // After a failed write the remaining buffers are only recycled, so
+        // that the caller doesn't wait for them before seeing the error
+        std::exception_ptr error;
+        if (!writer_failed_) {
+            try {
+                Write_(pending.data.get(), pending.size);
+            } catch (...) {
+                error = std::current_exception();
+                writer_failed_ = true;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(async_mutex_);
+            if (error)
+                writer_error_ = error;
+            free_buffers_.push_back(std::move(pending.data));
+        }
+        buffer_released_.notify_one();
+    }
+}
+
+void StringOutputStream::Flush()
+{
+    if (buffer_used_ == 0)
+        return;
+
+    if (!writer_.joinable()) {
+        // Emptied first so that nothing is passed on twice if Write_() throws
+        const size_t size = buffer_used_;
+        buffer_used_ = 0;
+        Write_(buffer_.get(), size);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(async_mutex_);
+    pending_buffers_.push_back({std::move(buffer_), buffer_used_});
+    buffer_queued_.notify_one();
+
+    buffer_released_.wait(lock, [this] { return !free_buffers_.empty(); });
+    buffer_ = std::move(free_buffers_.back());
+    free_buffers_.pop_back();
+    buffer_used_ = 0;
+    lock.unlock();
+    ThrowWriterError_();
 }
 
-void StringOutputStream::WriteLine(const std::string& str)
+void StringOutputStream::Append_(const char *data, size_t size)
 {
-    fputs(str.c_str(), file_);
-    length_ += str.size();
+    length_ += size;
+    while (size > kBufferSize - buffer_used_) {
+        const size_t chunk = kBufferSize - buffer_used_;
+        std::memcpy(buffer_.get() + buffer_used_, data, chunk);
+        buffer_used_ += chunk;
+        data += chunk;
+        size -= chunk;
+        Flush();
+    }
+    std::memcpy(buffer_.get() + buffer_used_, data, size);
+    buffer_used_ += size;
+}
+
+void StringOutputStream::WriteLine(std::string_view str)
+{
+    Append_(str.data(), str.size());
     WriteLine();
 }
 
 void StringOutputStream::WriteLine()
 {
-    fputs(kNewlineSequence, file_);
-    length_ += sizeof(kNewlineSequence) - 1 /* \0 - C-string ending length*/;
+    Append_(kNewlineSequence, sizeof(kNewlineSequence) - 1 /* \0 - C-string ending length*/);
 }
 
-void StringOutputStream::WriteQuoted(const std::string& str)
+void StringOutputStream::WriteQuoted(std::string_view str)
 {
-    fputc('\"', file_);
-    fputs(str.c_str(), file_);
-    fputc('\"', file_);
-    length_ += str.size() + 2;
+    Write('\"');
+    Append_(str.data(), str.size());
+    Write('\"');
 }
 
-void StringOutputStream::Write(const std::string& str)
+void StringOutputStream::Write(std::string_view str)
 {
-    fputs(str.c_str(), file_);
-    length_ += str.size();
+    Append_(str.data(), str.size());
 }
 
 void StringOutputStream::Write(char c)
 {
-    fputc(c, file_);
+    if (buffer_used_ == kBufferSize)
+        Flush();
+    buffer_[buffer_used_++] = c;
     ++length_;
 }
 
+void StringOutputStream::WriteInt(int64_t value)
+{
+    char digits[24];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    Append_(digits, result.ptr - digits);
+}
+
+void StringOutputStream::WriteQuotedInt(int64_t value)
+{
+    char digits[24];
+    digits[0] = '\"';
+    auto result = std::to_chars(digits + 1, digits + sizeof(digits) - 1, value);
+    *result.ptr++ = '\"';
+    Append_(digits, result.ptr - digits);
+}
+
+void StringOutputStream::WriteFixed(double value, int precision)
+{
+    // DBL_MAX has 309 integer digits
+    static constexpr int kMaxPrecision = 100;
+    char digits[320 + kMaxPrecision];
+    precision = std::clamp(precision, 0, kMaxPrecision);
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+    auto result = std::to_chars(digits, digits + sizeof(digits), value,
+                                std::chars_format::fixed, precision);
+    Append_(digits, result.ptr - digits);
+#else
+    // Standard libraries without floating-point to_chars()
+    const int length = snprintf(digits, sizeof(digits), "%.*f", precision, value);
+    Append_(digits, std::clamp(length, 0, static_cast<int>(sizeof(digits)) - 1));
+#endif
+}
+
+int64_t StringOutputStream::position() const noexcept
+{
+    return length_;
+}
+
 }  // namespace gene
@@ -18,23 +18,113 @@
 #define LIBGENE_IO_STREAMS_STRING_OUTPUTSTREAM_HPP_
 
 #include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <cstddef>
+#include <cstdint>
 
 #include "StringStream.hpp"
+#include "../backends/IoBackend.hpp"
 
 namespace gene {
 
+class CommandLineFlags;
+
+//
+// Writes are collected in a large user-space buffer, which is passed on to
+// Write_() only when it fills up or on Flush(). In async mode, full buffers
+// are handed to a writer thread instead and the caller continues with a
+// fresh one from a fixed pool, only blocking when the pool runs dry.
+//
 class StringOutputStream : public StringStream {
+ protected:
+    static constexpr size_t kBufferSize = 1 << 20;
+
+    std::unique_ptr<OutputBackend> output_;
+
+    StringOutputStream(const std::string& file_path, bool text, IoBackend backend);
+
+    // Receives the buffered output in chunks of up to kBufferSize bytes. In
+    // async mode it's called on the writer thread, and what it throws is
+    // rethrown by the next Flush() on the caller's thread.
+    virtual void Write_(const char *data, size_t size);
+
+    // Pass data on to the backend and close it, throwing
+    // prim::UserVisibleError if it fails. Closing more than once does nothing.
+    void WriteToOutput_(const void *data, size_t size);
+    void CloseOutput_();
+
+    // Flushes and waits until the writer thread has written everything out,
+    // then stops it. Subclasses overriding Write_() must call this before
+    // they're torn down.
+    void StopAsyncWrites_();
+
+ private:
+    struct PendingBuffer {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    std::unique_ptr<char[]> buffer_;
+    size_t buffer_used_{0};
+    bool output_closed_{false};
+
+    std::thread writer_;
+    std::mutex async_mutex_;
+    std::condition_variable buffer_queued_;
+    std::condition_variable buffer_released_;
+    std::deque<PendingBuffer> pending_buffers_;
+    std::vector<std::unique_ptr<char[]>> free_buffers_;
+    bool stop_writer_{false};
+    std::exception_ptr writer_error_;
+    // Only touched by the writer thread
+    bool writer_failed_{false};
+
+    void Append_(const char *data, size_t size);
+    void WriterLoop_();
+    void ThrowWriterError_();
+
  public:
-    explicit StringOutputStream(const std::string& file_path);
+    explicit StringOutputStream(const std::string& file_path,
+                                IoBackend backend = IoBackend::Stdio);
+    ~StringOutputStream();
     
+    // Paths ending in .gz, .bgz or .bam are written BGZF-compressed, and
+    // paths ending in .zst Zstandard-compressed
     static std::unique_ptr<StringOutputStream>
     StreamWithFileName(const std::string& file_path);
+    static std::unique_ptr<StringOutputStream>
+    StreamWithFileName(const std::string& file_path,
+                       const std::unique_ptr<CommandLineFlags>& flags);
     
-    void Write(const std::string& str);
-    void WriteLine(const std::string& str);
+    void Write(std::string_view str);
+    void WriteLine(std::string_view str);
     void WriteLine();
-    void WriteQuoted(const std::string& str);
+    void WriteQuoted(std::string_view str);
     void Write(char c);
+
+    // Number formatting straight into the output buffer, without temporary
+    // strings. WriteFixed() prints 'precision' (at most 100) decimal places,
+    // rounded the same as printf's "%.*f".
+    void WriteInt(int64_t value);
+    void WriteQuotedInt(int64_t value);
+    void WriteFixed(double value, int precision);
+
+    // Moves writes to a dedicated thread, with 'buffers' (at least 2)
+    // buffers of kBufferSize bytes in total
+    void EnableAsyncWrites(int buffers);
+
+    // Passes everything buffered so far on to the file (or to the writer
+    // thread in async mode)
+    void Flush();
+
+    int64_t position() const noexcept override;
 };
 
 }  // namespace gene
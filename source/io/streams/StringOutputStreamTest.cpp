@@ -0,0 +1,111 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Checks StringOutputStream's number formatting against printf, halfway
+// values in particular. Not part of the library; build it on its own with
+//
+//    c++ -std=c++17 -DLIBGENE_STRING_OUTPUT_STREAM_TEST StringOutputStreamTest.cpp \
+//        ../../libgene.a -lz -lzstd
+//
+// and run it in a writable directory.
+
+#ifdef LIBGENE_STRING_OUTPUT_STREAM_TEST
+
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "StringOutputStream.hpp"
+
+namespace {
+
+constexpr char kPath[] = "StringOutputStreamTest.txt";
+
+struct Case {
+    double value;
+    int precision;
+};
+
+std::string Printed(const Case& c)
+{
+    char printed[512];
+    snprintf(printed, sizeof(printed), "%.*f\n", c.precision, c.value);
+    return printed;
+}
+
+}  // namespace
+
+int main()
+{
+    std::vector<Case> cases = {
+        // Exactly halfway in binary, which printf rounds to even
+        {0.5, 0}, {1.5, 0}, {2.5, 0}, {-0.5, 0}, {-2.5, 0}, {0.125, 2}, {0.375, 2},
+        {-0.625, 2}, {1e15 + 0.5, 0}, {4503599627370495.5, 0},
+        // Halfway in decimal only, so rounded by their binary value
+        {1.005, 2}, {0.045, 2}, {2.675, 2}, {1.0000000005, 9},
+        // Negative values which round to zero keep their sign
+        {-0.0001, 2}, {-0.0, 3},
+        // Beyond the range of integers
+        {1e20, 2}, {-1.5e300, 1}, {DBL_MAX, 0}, {DBL_MIN, 100}, {0.1, 30},
+        {INFINITY, 2}, {-INFINITY, 0}
+    };
+    // Every multiple of 1/1024 is exact, and those ending in 5 at the
+    // 3rd decimal place halfway at 2
+    for (int i = -4096; i <= 4096; ++i) {
+        for (int precision = 0; precision <= 10; ++precision)
+            cases.push_back({i / 1024.0, precision});
+    }
+    std::mt19937_64 random(42);
+    std::uniform_real_distribution<double> uniform(-1e6, 1e6);
+    for (int i = 0; i < 100000; ++i)
+        cases.push_back({uniform(random), static_cast<int>(random() % 12)});
+
+    {
+        gene::StringOutputStream out(kPath);
+        for (const Case& c : cases) {
+            out.WriteFixed(c.value, c.precision);
+            out.WriteLine();
+        }
+    }
+
+    FILE *file = fopen(kPath, "r");
+    if (!file) {
+        fprintf(stderr, "Couldn't read back '%s'\n", kPath);
+        return 1;
+    }
+    int failures = 0;
+    char line[512];
+    for (const Case& c : cases) {
+        const std::string expected = Printed(c);
+        if (!fgets(line, sizeof(line), file) || expected != line) {
+            if (++failures <= 10)
+                fprintf(stderr, "WriteFixed(%.17g, %d) wrote '%s' instead of '%s'\n",
+                        c.value, c.precision, line, expected.c_str());
+        }
+    }
+    fclose(file);
+    remove(kPath);
+
+    printf("%zu values, %d wrong\n", cases.size(), failures);
+    return failures == 0 ? 0 : 1;
+}
+
+#endif  // LIBGENE_STRING_OUTPUT_STREAM_TEST
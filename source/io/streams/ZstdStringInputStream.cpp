@@ -0,0 +1,147 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <string>
+#include <cstdio>
+#include <zstd.h>
+
+#include "ZstdStringInputStream.hpp"
+#include "../../log/Logger.hpp"
+#include "../../utils/MiscPrimitives.hpp"
+
+namespace gene {
+
+ZstdStringInputStream::ZstdStringInputStream(const std::string& file_path, IoBackend backend)
+: StringInputStream(file_path)
+, input_(InputBackend::Open(file_path, backend))
+{
+    length_ = input_->length();
+
+    if (context_ = ZSTD_createDCtx(); context_ == nullptr)
+        throw prim::UserVisibleError("Couldn't initialize decompression of '" + file_path + "'");
+
+    input_buffer_ = std::make_unique<char[]>(kBufferSize);
+    output_buffer_ = std::make_unique<char[]>(kBufferSize);
+    data_ = output_buffer_.get();
+}
+
+ZstdStringInputStream::~ZstdStringInputStream()
+{
+    ZSTD_freeDCtx(context_);
+}
+
+bool ZstdStringInputStream::IsZstd(const std::string& file_path)
+{
+    FILE *file = fopen(file_path.c_str(), "rb");
+    if (!file)
+        return false;
+
+    uint8_t magic[4];
+    bool zstd = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                (magic[0] | magic[1] << 8 | magic[2] << 16 | static_cast<uint32_t>(magic[3]) << 24) ==
+                ZSTD_MAGICNUMBER;
+    fclose(file);
+    return zstd;
+}
+
+bool ZstdStringInputStream::FillBuffer_()
+{
+    buffer_offset_ += read_;
+    pos_ = 0;
+    read_ = 0;
+
+    if (eof_)
+        return false;
+
+    ZSTD_outBuffer output{output_buffer_.get(), static_cast<size_t>(kBufferSize), 0};
+    while (output.pos < output.size) {
+        if (compressed_pos_ == compressed_size_) {
+            int64_t read = input_->Read(input_buffer_.get(), kBufferSize);
+            if (read <= 0) {
+                if (!frame_complete_)
+                    PrintfLog("Unexpected end of compressed file at offset %lld.\n",
+                              static_cast<long long>(position()));
+                eof_ = true;
+                break;
+            }
+            compressed_size_ = static_cast<size_t>(read);
+            compressed_pos_ = 0;
+        }
+
+        ZSTD_inBuffer input{input_buffer_.get(), compressed_size_, compressed_pos_};
+        size_t result = ZSTD_decompressStream(context_, &output, &input);
+        compressed_pos_ = input.pos;
+        if (ZSTD_isError(result)) {
+            PrintfLog("Damaged compressed file. Couldn't decompress data at offset %lld: %s.\n",
+                      static_cast<long long>(position()), ZSTD_getErrorName(result));
+            eof_ = true;
+            break;
+        }
+        frame_complete_ = (result == 0);
+    }
+
+    read_ = output.pos;
+    return read_ > 0;
+}
+
+std::string_view ZstdStringInputStream::ReadLineView()
+{
+    return ReadBufferedLineView_();
+}
+
+std::string ZstdStringInputStream::ReadLine()
+{
+    return std::string(ReadLineView());
+}
+
+int ZstdStringInputStream::Peek()
+{
+    if (pos_ >= read_ && !FillBuffer_())
+        return EOF;
+
+    return data_[pos_];
+}
+
+void ZstdStringInputStream::ResetFilePointer()
+{
+    input_->Seek(0);
+    ZSTD_DCtx_reset(context_, ZSTD_reset_session_only);
+    compressed_size_ = 0;
+    compressed_pos_ = 0;
+    frame_complete_ = true;
+    eof_ = false;
+    pos_ = 0;
+    read_ = 0;
+    buffer_offset_ = 0;
+}
+
+bool ZstdStringInputStream::empty() const
+{
+    return eof_ && pos_ >= read_;
+}
+
+int64_t ZstdStringInputStream::position() const noexcept
+{
+    return input_->position() - static_cast<int64_t>(compressed_size_ - compressed_pos_);
+}
+
+int64_t ZstdStringInputStream::uncompressed_position() const noexcept
+{
+    return buffer_offset_ + pos_;
+}
+
+}  // namespace gene
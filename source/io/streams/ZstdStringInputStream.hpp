@@ -0,0 +1,76 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_STREAMS_ZSTDSTRINGINPUTSTREAM_HPP_
+#define LIBGENE_IO_STREAMS_ZSTDSTRINGINPUTSTREAM_HPP_
+
+#include <string>
+#include <string_view>
+#include <memory>
+
+#include "StringInputStream.hpp"
+#include "../backends/IoBackend.hpp"
+
+// From <zstd.h>, which only the .cpp needs
+typedef struct ZSTD_DCtx_s ZSTD_DCtx;
+
+namespace gene {
+
+//
+// Input stream over a Zstandard-compressed text file. Concatenated and
+// skippable frames are handled like the zstd tool does. .zst files which
+// don't start with a zstd frame are read as plain text by the factory.
+//
+class ZstdStringInputStream final : public StringInputStream {
+ public:
+    explicit ZstdStringInputStream(const std::string& file_path,
+                                   IoBackend backend = IoBackend::Stdio);
+    ~ZstdStringInputStream();
+
+    // Checks whether the file starts with a zstd frame
+    static bool IsZstd(const std::string& file_path);
+
+    std::string ReadLine() override;
+    std::string_view ReadLineView() override;
+    int Peek() override;
+    void ResetFilePointer() override;
+    bool empty() const override;
+
+    int64_t position() const noexcept override;
+    int64_t uncompressed_position() const noexcept override;
+
+ private:
+    static constexpr int64_t kBufferSize = 1 << 20;
+
+    bool FillBuffer_() override;
+
+    std::unique_ptr<InputBackend> input_;
+    ZSTD_DCtx *context_;
+    std::unique_ptr<char[]> input_buffer_;
+    std::unique_ptr<char[]> output_buffer_;
+    // Compressed bytes in input_buffer_, and how many zstd has taken
+    size_t compressed_size_{0};
+    size_t compressed_pos_{0};
+    // The last call finished a frame, so running out of input is fine
+    bool frame_complete_{true};
+    bool eof_{false};
+    // Uncompressed offset of the beginning of the buffer being parsed
+    int64_t buffer_offset_{0};
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_STREAMS_ZSTDSTRINGINPUTSTREAM_HPP_
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <thread>
+#include <zstd.h>
+
+#include "ZstdStringOutputStream.hpp"
+#include "../../log/Logger.hpp"
+#include "../../utils/MiscPrimitives.hpp"
+
+namespace gene {
+
+ZstdStringOutputStream::ZstdStringOutputStream(const std::string& file_path, int threads,
+                                               int level, IoBackend backend)
+: StringOutputStream(file_path, false, backend)
+{
+    if (context_ = ZSTD_createCCtx(); context_ == nullptr)
+        throw prim::UserVisibleError("Couldn't initialize compression of '" + file_path + "'");
+
+    ZSTD_CCtx_setParameter(context_, ZSTD_c_compressionLevel, level);
+    ZSTD_CCtx_setParameter(context_, ZSTD_c_checksumFlag, 1);
+
+    // Fails (and leaves compression on this thread) if libzstd was built
+    // without multithreading
+    const int workers = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    ZSTD_CCtx_setParameter(context_, ZSTD_c_nbWorkers, workers);
+
+    compressed_size_ = ZSTD_CStreamOutSize();
+    compressed_ = std::make_unique<char[]>(compressed_size_);
+}
+
+ZstdStringOutputStream::~ZstdStringOutputStream()
+{
+    try {
+        Close();
+    } catch (const prim::UserVisibleError& error) {
+        PrintfLog("%s\n", error.what());
+    }
+    ZSTD_freeCCtx(context_);
+}
+
+void ZstdStringOutputStream::Compress_(const char *data, size_t size, bool end_frame)
+{
+    const ZSTD_EndDirective directive = end_frame ? ZSTD_e_end : ZSTD_e_continue;
+    ZSTD_inBuffer input{data, size, 0};
+    bool finished = false;
+    while (!finished && !failed_) {
+        ZSTD_outBuffer output{compressed_.get(), compressed_size_, 0};
+        size_t remaining = ZSTD_compressStream2(context_, &output, &input, directive);
+        if (ZSTD_isError(remaining)) {
+            failed_ = true;
+            throw prim::UserVisibleError("Couldn't compress '" + path_ + "': " +
+                                         ZSTD_getErrorName(remaining));
+        }
+        if (output.pos > 0)
+            WriteToOutput_(compressed_.get(), output.pos);
+
+        // Ending the frame takes as many calls as it takes to flush
+        // everything, otherwise it's done once all the input is taken
+        finished = directive == ZSTD_e_end ? remaining == 0 : input.pos == input.size;
+    }
+}
+
+void ZstdStringOutputStream::ThrowIfFailed_()
+{
+    if (failed_)
+        throw prim::UserVisibleError("Couldn't compress '" + path_ + "'");
+}
+
+void ZstdStringOutputStream::Write_(const char *data, size_t size)
+{
+    ThrowIfFailed_();
+    Compress_(data, size, false);
+}
+
+void ZstdStringOutputStream::Close()
+{
+    if (closed_)
+        return;
+    closed_ = true;
+    StopAsyncWrites_();
+    Flush();
+
+    Compress_(nullptr, 0, true);
+    ThrowIfFailed_();
+    CloseOutput_();
+}
+
+}  // namespace gene
@@ -0,0 +1,64 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_IO_STREAMS_ZSTDSTRINGOUTPUTSTREAM_HPP_
+#define LIBGENE_IO_STREAMS_ZSTDSTRINGOUTPUTSTREAM_HPP_
+
+#include <string>
+#include <memory>
+
+#include "StringOutputStream.hpp"
+
+// From <zstd.h>, which only the .cpp needs
+typedef struct ZSTD_CCtx_s ZSTD_CCtx;
+
+namespace gene {
+
+//
+// Output stream which writes a single Zstandard frame. zstd compresses
+// the input in parallel jobs on its own worker threads, so writes only
+// block while all of them are busy.
+//
+class ZstdStringOutputStream final : public StringOutputStream {
+ public:
+    // 'threads' <= 0 uses one worker per hardware thread. 'level' is the
+    // same as for the zstd tool, 0 picks zstd's default (3).
+    explicit ZstdStringOutputStream(const std::string& file_path, int threads = 0,
+                                    int level = 0,
+                                    IoBackend backend = IoBackend::Stdio);
+    ~ZstdStringOutputStream();
+
+    // Compresses what's left and ends the frame. Called by the destructor if
+    // not called before. Throws prim::UserVisibleError, like writes, if the
+    // data couldn't be compressed or written; the destructor only logs it.
+    void Close();
+
+ private:
+    void Write_(const char *data, size_t size) override;
+    void Compress_(const char *data, size_t size, bool end_frame);
+    void ThrowIfFailed_();
+
+    ZSTD_CCtx *context_;
+    std::unique_ptr<char[]> compressed_;
+    size_t compressed_size_;
+    bool closed_{false};
+    // Set once compression failed, after which nothing more is written
+    bool failed_{false};
+};
+
+}  // namespace gene
+
+#endif  // LIBGENE_IO_STREAMS_ZSTDSTRINGOUTPUTSTREAM_HPP_
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <zlib.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define LIBGENE_CRC32_PCLMUL
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define LIBGENE_CRC32_ARM
+#include <arm_acle.h>
+#endif
+
+#include "Crc32.hpp"
+
+namespace gene::utils {
+
+#ifdef LIBGENE_CRC32_PCLMUL
+
+// Folding constants for the bit-reflected gzip polynomial, from Intel's
+// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+alignas(16) constexpr uint64_t kFold4x128[2] = {0x0154442bd4, 0x01c6e41596};
+alignas(16) constexpr uint64_t kFold1x128[2] = {0x01751997d0, 0x00ccaa009e};
+alignas(16) constexpr uint64_t kFold64[2] = {0x0163cd6124, 0x0000000000};
+alignas(16) constexpr uint64_t kBarrett[2] = {0x01db710641, 0x01f7011641};
+
+// Folds 'x' forward over the distance 'k' was computed for and adds 'next'
+__attribute__((target("pclmul")))
+static inline __m128i Fold(__m128i x, __m128i k, __m128i next)
+{
+    __m128i low = _mm_clmulepi64_si128(x, k, 0x00);
+    __m128i high = _mm_clmulepi64_si128(x, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(high, low), next);
+}
+
+// Works on whole 16-byte chunks, at least 64 bytes. Takes and returns the
+// CRC without the final inversion.
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t Crc32Pclmul(uint32_t crc, const uint8_t *data, size_t size)
+{
+    auto load = [](const uint8_t *p) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    };
+
+    __m128i x1 = _mm_xor_si128(load(data), _mm_cvtsi32_si128(static_cast<int>(crc)));
+    __m128i x2 = load(data + 16);
+    __m128i x3 = load(data + 32);
+    __m128i x4 = load(data + 48);
+    data += 64;
+    size -= 64;
+
+    // Four lanes of 128 bits folded forward 512 bits at a time
+    __m128i k = _mm_load_si128(reinterpret_cast<const __m128i *>(kFold4x128));
+    while (size >= 64) {
+        x1 = Fold(x1, k, load(data));
+        x2 = Fold(x2, k, load(data + 16));
+        x3 = Fold(x3, k, load(data + 32));
+        x4 = Fold(x4, k, load(data + 48));
+        data += 64;
+        size -= 64;
+    }
+
+    // Then into a single lane, which takes the remaining chunks
+    k = _mm_load_si128(reinterpret_cast<const __m128i *>(kFold1x128));
+    x1 = Fold(x1, k, x2);
+    x1 = Fold(x1, k, x3);
+    x1 = Fold(x1, k, x4);
+    while (size >= 16) {
+        x1 = Fold(x1, k, load(data));
+        data += 16;
+        size -= 16;
+    }
+
+    // 128 bits down to 64
+    const __m128i low32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x2 = _mm_clmulepi64_si128(x1, k, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    k = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(kFold64));
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x1, low32), k, 0x00), x2);
+
+    // Barrett reduction to 32 bits
+    k = _mm_load_si128(reinterpret_cast<const __m128i *>(kBarrett));
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, low32), k, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, low32), k, 0x00);
+    return static_cast<uint32_t>(_mm_extract_epi32(_mm_xor_si128(x1, x2), 1));
+}
+
+static bool HasPclmul()
+{
+    static const bool has = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+    return has;
+}
+
+uint32_t Crc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    if (size >= 64 && HasPclmul()) {
+        const size_t chunks = size & ~static_cast<size_t>(15);
+        crc = ~Crc32Pclmul(~crc, data, chunks);
+        data += chunks;
+        size -= chunks;
+    }
+    return size > 0 ? static_cast<uint32_t>(crc32(crc, data, static_cast<uInt>(size))) : crc;
+}
+
+#elif defined(LIBGENE_CRC32_ARM)
+
+uint32_t Crc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    crc = ~crc;
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        crc = __crc32d(crc, word);
+        data += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        crc = __crc32b(crc, *data++);
+        size--;
+    }
+    return ~crc;
+}
+
+#else
+
+uint32_t Crc32(uint32_t crc, const uint8_t *data, size_t size)
+{
+    // zlib takes at most 4 GiB at a time
+    while (size > 0) {
+        const uInt chunk = static_cast<uInt>(size < 0x40000000 ? size : 0x40000000);
+        crc = static_cast<uint32_t>(crc32(crc, data, chunk));
+        data += chunk;
+        size -= chunk;
+    }
+    return crc;
+}
+
+#endif
+
+}  // namespace gene::utils
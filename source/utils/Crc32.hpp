@@ -0,0 +1,33 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIBGENE_UTILS_CRC32_HPP_
+#define LIBGENE_UTILS_CRC32_HPP_
+
+#include <cstdint>
+#include <cstddef>
+
+namespace gene::utils {
+
+// The gzip CRC-32 of 'data' continuing from 'crc' (0 to start), same as
+// zlib's crc32(). Uses carry-less multiplication (PCLMULQDQ) on x86-64 CPUs
+// that have it and the CRC32 instructions on ARMv8, which run several times
+// faster than zlib's table-driven implementation.
+uint32_t Crc32(uint32_t crc, const uint8_t *data, size_t size);
+
+}  // namespace gene::utils
+
+#endif  // LIBGENE_UTILS_CRC32_HPP_
@@ -0,0 +1,103 @@
+/*
+ * Copyright 2018 Frangou Lab
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+// Compares utils::Crc32() with zlib's crc32() for correctness and speed.
+// Not part of the library; build it on its own with
+//
+//    c++ -O2 -std=c++17 -DLIBGENE_CRC32_BENCHMARK Crc32Benchmark.cpp Crc32.cpp -lz
+//
+// and run it with an optional buffer size in bytes (64 KiB by default, the
+// size of a BGZF block).
+
+#ifdef LIBGENE_CRC32_BENCHMARK
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include <zlib.h>
+
+#include "Crc32.hpp"
+
+namespace {
+
+constexpr size_t kDefaultSize = 64 * 1024;
+constexpr size_t kBytesPerRun = size_t{1} << 30;
+
+template <typename F>
+double MeasureGigabytesPerSecond(F&& crc, const std::vector<uint8_t>& data, uint32_t& result)
+{
+    const size_t runs = std::max<size_t>(kBytesPerRun / data.size(), 1);
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < runs; ++i)
+        result = crc(result, data.data(), data.size());
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return runs * data.size() / elapsed.count() / 1e9;
+}
+
+}  // namespace
+
+int main(int argc, char *argv[])
+{
+    const size_t size = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : kDefaultSize;
+    if (size == 0) {
+        std::fprintf(stderr, "usage: %s [buffer size in bytes]\n", argv[0]);
+        return 1;
+    }
+
+    std::mt19937 random(42);
+    std::vector<uint8_t> data(size);
+    for (auto& byte : data)
+        byte = static_cast<uint8_t>(random());
+
+    // Every length and alignment up to a few chunks, to cover the head and
+    // tail handling around the vectorized loop
+    for (size_t offset = 0; offset < 16 && offset < size; ++offset) {
+        for (size_t length = 0; offset + length <= size && length <= 1024; ++length) {
+            const uint32_t expected = static_cast<uint32_t>(
+                crc32(0x12345678, data.data() + offset, static_cast<uInt>(length)));
+            const uint32_t actual = gene::utils::Crc32(0x12345678, data.data() + offset, length);
+            if (actual != expected) {
+                std::fprintf(stderr, "Mismatch at offset %zu, length %zu: %08x instead of %08x\n",
+                             offset, length, actual, expected);
+                return 1;
+            }
+        }
+    }
+
+    uint32_t zlib_result = 0;
+    uint32_t own_result = 0;
+    const double zlib_speed = MeasureGigabytesPerSecond(
+        [](uint32_t crc, const uint8_t *p, size_t n) {
+            return static_cast<uint32_t>(crc32(crc, p, static_cast<uInt>(n)));
+        },
+        data, zlib_result);
+    const double own_speed = MeasureGigabytesPerSecond(gene::utils::Crc32, data, own_result);
+    if (own_result != zlib_result) {
+        std::fprintf(stderr, "Results differ: %08x instead of %08x\n", own_result, zlib_result);
+        return 1;
+    }
+
+    std::printf("%zu-byte buffers\n", size);
+    std::printf("zlib crc32:   %6.2f GB/s\n", zlib_speed);
+    std::printf("utils::Crc32: %6.2f GB/s (%.1fx)\n", own_speed, own_speed / zlib_speed);
+    return 0;
+}
+
+#endif  // LIBGENE_CRC32_BENCHMARK
@@ -39,6 +39,11 @@ bool HasExtension(const std::string& path, const std::string ext)
     return (size >= extSize + 1 && extension == "." + ext);
 }
 
+bool IsCompressedExtension(const std::string& extension)
+{
+    return extension == "gz" || extension == "bgz" || extension == "zst";
+}
+
 std::string GetExtension(const std::string& str)
 {
     auto dot = str.rfind('.');
@@ -51,7 +56,7 @@ std::string GetExtension(const std::string& str)
 std::string GetExtensionCompressed(const std::string& path)
 {
     auto extension = GetExtension(path);
-    if (extension == "gz")
+    if (IsCompressedExtension(extension))
         extension = GetExtension(StringByDeletingPathExtension(path));
     return extension;
 }
@@ -116,7 +121,7 @@ std::string StringByDeletingPathExtensionCompressed(const std::string& path)
     auto extension = GetExtension(path);
     auto result = StringByDeletingPathExtension(path);
 
-    if (extension == "gz")
+    if (IsCompressedExtension(extension))
         result = StringByDeletingPathExtension(result);
 
     return result;
@@ -33,7 +33,12 @@ std::string InsertSuffixBeforePathExtension(std::string path, std::string suffix
 
 bool HasExtension(const std::string& path, const std::string ext);
 
+// Whether 'extension' (without the dot) is one of the compression formats
+// the streams read and write transparently: "gz", "bgz" or "zst"
+bool IsCompressedExtension(const std::string& extension);
+
 std::string GetExtension(const std::string& path);
+// Extension in front of the compression one, if any: "fastq" for x.fastq.zst
 std::string GetExtensionCompressed(const std::string& path);
 std::string GetLastPathComponent(const std::string& path);
 